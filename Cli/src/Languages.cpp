@@ -0,0 +1,60 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+             
+// THIS FILE IS AUTO-GENERATED. DO NOT EDIT.
+
+#include "Languages.h"
+
+#include <Mapper/Utf8Mapper.hpp>
+
+#include "../../Translit/tables/TableBE.hpp"
+#include "../../Translit/tables/TableHE.hpp"
+#include "../../Translit/tables/TableRU.hpp"
+#include "../../Translit/tables/TableUK.hpp"
+
+using Range = Transliterator::Range;
+
+template<class Mapper>
+auto serialize() -> std::vector<std::byte> {
+    return serializeTable(Mapper{});
+}
+
+template<class Mapper>
+auto transliterateUtf8Chunk(std::string_view in, std::string & out, bool final) -> size_t {
+    constexpr auto mapper = makeUtf8Mapper(Mapper{});
+    if (!final)
+        return transliterateDefinite(mapper, in, out);
+    transliterate(mapper, in, out);
+    return in.size();
+}
+
+constexpr MappingInfo g_beMappings[] = {
+    { "", "default", g_mapperBeDefault<Range>, serialize<decltype(g_mapperBeDefault<Range>)>, transliterateUtf8Chunk<decltype(g_mapperBeDefault<Range>)> },
+    { "translit-ru", "translit.net", g_mapperBeTranslitRu<Range>, serialize<decltype(g_mapperBeTranslitRu<Range>)>, transliterateUtf8Chunk<decltype(g_mapperBeTranslitRu<Range>)> },
+};
+
+constexpr MappingInfo g_heMappings[] = {
+    { "", "default", g_mapperHeDefault<Range>, serialize<decltype(g_mapperHeDefault<Range>)>, transliterateUtf8Chunk<decltype(g_mapperHeDefault<Range>)> },
+};
+
+constexpr MappingInfo g_ruMappings[] = {
+    { "", "default", g_mapperRuDefault<Range>, serialize<decltype(g_mapperRuDefault<Range>)>, transliterateUtf8Chunk<decltype(g_mapperRuDefault<Range>)> },
+    { "translit-ru", "translit.ru", g_mapperRuTranslitRu<Range>, serialize<decltype(g_mapperRuTranslitRu<Range>)>, transliterateUtf8Chunk<decltype(g_mapperRuTranslitRu<Range>)> },
+};
+
+constexpr MappingInfo g_ukMappings[] = {
+    { "", "default", g_mapperUkDefault<Range>, serialize<decltype(g_mapperUkDefault<Range>)>, transliterateUtf8Chunk<decltype(g_mapperUkDefault<Range>)> },
+    { "translit-ru", "translit.net", g_mapperUkTranslitRu<Range>, serialize<decltype(g_mapperUkTranslitRu<Range>)>, transliterateUtf8Chunk<decltype(g_mapperUkTranslitRu<Range>)> },
+};
+
+constexpr LanguageInfo g_languages[] = {
+    { "be", "Belarusian", g_beMappings },
+    { "he", "Hebrew", g_heMappings },
+    { "ru", "Russian", g_ruMappings },
+    { "uk", "Ukrainian", g_ukMappings }
+};
+
+auto getLanguages() -> std::span<const LanguageInfo> {
+    return g_languages;
+}
+
@@ -0,0 +1,35 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <Mapper/Transliterator.hpp>
+#include <Mapper/FlatTable.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct MappingInfo {
+    const char * name;
+    const char * displayName;
+    Transliterator::MappingFunc * mapper;
+    /** Returns the table in the format loaded by FlatMapper */
+    auto (*serialize)() -> std::vector<std::byte>;
+    /**
+     Transliterates UTF-8 without going through UTF-16
+
+     Unless final is set stops before the part of the input that more input could change
+     and returns the number of bytes consumed. Otherwise consumes everything.
+     */
+    auto (*transliterateUtf8)(std::string_view in, std::string & out, bool final) -> size_t;
+};
+
+struct LanguageInfo {
+    const char * lang;
+    const char * displayName;
+    std::span<const MappingInfo> mappings;
+};
+
+auto getLanguages() -> std::span<const LanguageInfo>;
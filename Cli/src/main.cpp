@@ -0,0 +1,523 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Languages.h"
+
+#include <Mapper/MappedFile.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <system_error>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+namespace {
+
+    constexpr size_t g_chunkSize = 64 * 1024;
+
+    enum class Encoding {
+        utf8,
+        utf16le,
+        utf16be
+    };
+
+    auto parseEncoding(std::string_view name) -> std::optional<Encoding> {
+        if (name == "utf-8" || name == "utf8")
+            return Encoding::utf8;
+        if (name == "utf-16le" || name == "utf16le")
+            return Encoding::utf16le;
+        if (name == "utf-16be" || name == "utf16be")
+            return Encoding::utf16be;
+        return std::nullopt;
+    }
+
+    auto detectEncoding(std::span<const unsigned char> bytes) -> Encoding {
+        if (bytes.size() >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE)
+            return Encoding::utf16le;
+        if (bytes.size() >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF)
+            return Encoding::utf16be;
+        return Encoding::utf8;
+    }
+
+    void appendUtf8(char32_t c, std::string & out) {
+        if (c < 0x80) {
+            out += char(c);
+        } else if (c < 0x800) {
+            out += char(0xC0 | (c >> 6));
+            out += char(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += char(0xE0 | (c >> 12));
+            out += char(0x80 | ((c >> 6) & 0x3F));
+            out += char(0x80 | (c & 0x3F));
+        } else {
+            out += char(0xF0 | (c >> 18));
+            out += char(0x80 | ((c >> 12) & 0x3F));
+            out += char(0x80 | ((c >> 6) & 0x3F));
+            out += char(0x80 | (c & 0x3F));
+        }
+    }
+
+    /**
+     Incremental UTF-8 reader that carries incomplete sequences across chunks.
+     Passes each code point to the sink, malformed input as U+FFFD.
+     */
+    class Utf8Reader {
+    public:
+        static constexpr char32_t replacement = U'\uFFFD';
+
+        template<class Sink>
+        void read(unsigned char byte, Sink && sink) {
+            if (m_pendingCount > 0) {
+                if ((byte & 0xC0) == 0x80) {
+                    m_value = (m_value << 6) | (byte & 0x3F);
+                    if (--m_pendingCount == 0) {
+                        if (m_value < m_minValue || m_value > 0x10FFFF || (m_value >= 0xD800 && m_value <= 0xDFFF))
+                            sink(replacement);
+                        else
+                            sink(m_value);
+                    }
+                    return;
+                }
+                //truncated sequence: replace it and reprocess this byte as a lead
+                sink(replacement);
+                m_pendingCount = 0;
+            }
+            if (byte < 0x80) {
+                sink(char32_t(byte));
+            } else if ((byte & 0xE0) == 0xC0) {
+                m_value = byte & 0x1F;
+                m_pendingCount = 1;
+                m_minValue = 0x80;
+            } else if ((byte & 0xF0) == 0xE0) {
+                m_value = byte & 0x0F;
+                m_pendingCount = 2;
+                m_minValue = 0x800;
+            } else if ((byte & 0xF8) == 0xF0) {
+                m_value = byte & 0x07;
+                m_pendingCount = 3;
+                m_minValue = 0x10000;
+            } else {
+                sink(replacement);
+            }
+        }
+
+        template<class Sink>
+        void finish(Sink && sink) {
+            if (m_pendingCount != 0)
+                sink(replacement);
+            m_pendingCount = 0;
+        }
+
+        auto inSequence() const -> bool
+            { return m_pendingCount != 0; }
+
+    private:
+        char32_t m_value = 0;
+        char32_t m_minValue = 0;
+        int m_pendingCount = 0;
+    };
+
+    /**
+     Incremental decoder that carries incomplete sequences across chunks.
+     Malformed input is replaced with U+FFFD.
+     */
+    class Decoder {
+    public:
+        Decoder(Encoding encoding): m_encoding(encoding)
+        {}
+
+        void decode(std::span<const unsigned char> bytes, std::u16string & out) {
+            if (m_encoding == Encoding::utf8) {
+                for(auto byte: bytes)
+                    m_utf8.read(byte, [&](char32_t c) { appendCodePoint(c, out); });
+            } else {
+                for(auto byte: bytes) {
+                    if (!m_hasByte) {
+                        m_byte = byte;
+                        m_hasByte = true;
+                        continue;
+                    }
+                    if (m_encoding == Encoding::utf16le)
+                        out += char16_t(m_byte | (char16_t(byte) << 8));
+                    else
+                        out += char16_t((m_byte << 8) | byte);
+                    m_hasByte = false;
+                }
+            }
+        }
+
+        void finish(std::u16string & out) {
+            m_utf8.finish([&](char32_t c) { appendCodePoint(c, out); });
+            if (m_hasByte)
+                out += char16_t(Utf8Reader::replacement);
+            m_hasByte = false;
+        }
+
+    private:
+        static void appendCodePoint(char32_t c, std::u16string & out) {
+            if (c < 0x10000) {
+                out += char16_t(c);
+            } else {
+                c -= 0x10000;
+                out += char16_t(0xD800 + (c >> 10));
+                out += char16_t(0xDC00 + (c & 0x3FF));
+            }
+        }
+
+    private:
+        Encoding m_encoding;
+        Utf8Reader m_utf8;
+        unsigned char m_byte = 0;
+        bool m_hasByte = false;
+    };
+
+    /**
+     Incremental UTF-8 to UTF-8 copy that replaces malformed input with U+FFFD,
+     the same way Decoder does, and holds back incomplete sequences across chunks.
+     */
+    class Utf8Validator {
+    public:
+        void validate(std::span<const unsigned char> bytes, std::string & out) {
+            auto sink = [&](char32_t c) { appendUtf8(c, out); };
+            for(auto current = bytes.begin(); current != bytes.end(); ) {
+                if (!m_reader.inSequence()) {
+                    //ASCII runs are copied as is
+                    auto run = std::find_if(current, bytes.end(), [](unsigned char byte) { return byte >= 0x80; });
+                    out.append((const char *)&*current, size_t(run - current));
+                    if ((current = run) == bytes.end())
+                        break;
+                }
+                m_reader.read(*current++, sink);
+            }
+        }
+
+        void finish(std::string & out) {
+            m_reader.finish([&](char32_t c) { appendUtf8(c, out); });
+        }
+
+    private:
+        Utf8Reader m_reader;
+    };
+
+    /**
+     Incremental encoder that carries a trailing high surrogate across chunks.
+     Unpaired surrogates are replaced with U+FFFD when encoding to UTF-8.
+     */
+    class Encoder {
+    public:
+        Encoder(Encoding encoding): m_encoding(encoding)
+        {}
+
+        void encode(std::u16string_view str, std::string & out) {
+            for(auto c: str) {
+                if (m_encoding == Encoding::utf16le) {
+                    out += char(c & 0xFF);
+                    out += char(c >> 8);
+                } else if (m_encoding == Encoding::utf16be) {
+                    out += char(c >> 8);
+                    out += char(c & 0xFF);
+                } else {
+                    encodeUtf8(c, out);
+                }
+            }
+        }
+
+        void finish(std::string & out) {
+            if (m_highSurrogate) {
+                appendUtf8(replacement, out);
+                m_highSurrogate = 0;
+            }
+        }
+
+    private:
+        void encodeUtf8(char16_t c, std::string & out) {
+            if (m_highSurrogate) {
+                if (c >= 0xDC00 && c <= 0xDFFF) {
+                    appendUtf8(0x10000 + ((char32_t(m_highSurrogate) - 0xD800) << 10) + (c - 0xDC00), out);
+                    m_highSurrogate = 0;
+                    return;
+                }
+                appendUtf8(replacement, out);
+                m_highSurrogate = 0;
+            }
+            if (c >= 0xD800 && c <= 0xDBFF)
+                m_highSurrogate = c;
+            else if (c >= 0xDC00 && c <= 0xDFFF)
+                appendUtf8(replacement, out);
+            else
+                appendUtf8(c, out);
+        }
+
+    private:
+        static constexpr char32_t replacement = U'\uFFFD';
+
+        Encoding m_encoding;
+        char16_t m_highSurrogate = 0;
+    };
+
+    auto readChunk(FILE * file, std::vector<unsigned char> & buffer) -> std::span<const unsigned char> {
+        size_t read = fread(buffer.data(), 1, buffer.size(), file);
+        if (read == 0 && ferror(file))
+            throw std::system_error(errno, std::generic_category(), "unable to read input");
+        return {buffer.data(), read};
+    }
+
+    void write(FILE * file, const std::string & data) {
+        if (data.empty())
+            return;
+        if (fwrite(data.data(), 1, data.size(), file) != data.size())
+            throw std::system_error(errno, std::generic_category(), "unable to write output");
+    }
+
+    auto findMapping(std::string_view lang, std::string_view name) -> const MappingInfo * {
+        if (name == "default")
+            name = "";
+        for(auto & language: getLanguages()) {
+            if (language.lang != lang)
+                continue;
+            for(auto & mapping: language.mappings) {
+                if (mapping.name == name)
+                    return &mapping;
+            }
+        }
+        return nullptr;
+    }
+
+    void listLanguages() {
+        for(auto & language: getLanguages()) {
+            printf("%s\t%s\n", language.lang, language.displayName);
+            for(auto & mapping: language.mappings)
+                printf("    %s\t%s\n", *mapping.name ? mapping.name : "default", mapping.displayName);
+        }
+    }
+
+    void usage(FILE * file) {
+        fprintf(file,
+            "usage: translit-cli -l LANG [-m MAPPING] [-e ENCODING] [FILE]\n"
+            "       translit-cli -t TABLE [-e ENCODING] [FILE]\n"
+            "       translit-cli -l LANG [-m MAPPING] --export TABLE\n"
+            "       translit-cli --list\n"
+            "\n"
+            "Transliterates FILE (or stdin) to stdout.\n"
+            "\n"
+            "  -l, --language LANG      target language, e.g. ru\n"
+            "  -m, --mapping MAPPING    mapping variant, e.g. translit-ru (default: default)\n"
+            "  -t, --table TABLE        use a table file written by --export instead of -l/-m\n"
+            "      --export TABLE       write the table of -l/-m to TABLE and exit\n"
+            "  -e, --encoding ENCODING  utf-8, utf-16le or utf-16be for both input and output\n"
+            "                           (default: detected from BOM, otherwise utf-8)\n"
+            "      --list               list available languages and mappings\n"
+            "  -h, --help               show this help\n");
+    }
+
+    void exportTable(const MappingInfo & mapping, const char * path) {
+        auto bytes = mapping.serialize();
+        FILE * file = fopen(path, "wb");
+        if (!file)
+            throw std::system_error(errno, std::generic_category(), std::string("unable to open ") + path);
+        bool ok = (fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+        int err = errno;
+        ok = (fclose(file) == 0) && ok;
+        if (!ok)
+            throw std::system_error(err, std::generic_category(), std::string("unable to write ") + path);
+    }
+
+    /**
+     Streams input through the transliterator in fixed size chunks, starting with the
+     already read first one. Only the undecided tail of a match is carried between chunks
+     so memory stays bounded regardless of input size.
+     */
+    template<class Mapper>
+    void transliterateStream(FILE * in, FILE * out, Mapper mapper, Encoding encoding,
+                             std::vector<unsigned char> & buffer, std::span<const unsigned char> first) {
+
+        std::u16string decoded;
+        std::string encoded;
+        Decoder decoder(encoding);
+        Encoder encoder(encoding);
+        BasicTransliterator<Mapper> transliterator(mapper);
+
+        auto flush = [&]() {
+            auto result = transliterator.result();
+            encoded.clear();
+            encoder.encode(result.substr(0, transliterator.completedSize()), encoded);
+            write(out, encoded);
+            transliterator.clearCompleted();
+        };
+
+        for(auto bytes = first; !bytes.empty(); bytes = readChunk(in, buffer)) {
+            decoded.clear();
+            decoder.decode(bytes, decoded);
+            transliterator.append(decoded);
+            flush();
+        }
+
+        decoded.clear();
+        decoder.finish(decoded);
+        transliterator.append(decoded);
+        transliterator.finish();
+        flush();
+        encoded.clear();
+        encoder.finish(encoded);
+        write(out, encoded);
+        if (fflush(out) != 0)
+            throw std::system_error(errno, std::generic_category(), "unable to write output");
+    }
+
+    /**
+     Same as transliterateStream() for UTF-8 with a built-in mapping but without converting
+     to UTF-16 and back. Only bytes that more input could change are carried between chunks.
+     */
+    void transliterateUtf8Stream(FILE * in, FILE * out, const MappingInfo & mapping,
+                                 std::vector<unsigned char> & buffer, std::span<const unsigned char> first) {
+
+        std::string pending;
+        std::string encoded;
+        Utf8Validator validator;
+
+        for(auto bytes = first; !bytes.empty(); bytes = readChunk(in, buffer)) {
+            validator.validate(bytes, pending);
+            encoded.clear();
+            pending.erase(0, mapping.transliterateUtf8(pending, encoded, false));
+            write(out, encoded);
+        }
+
+        validator.finish(pending);
+        encoded.clear();
+        mapping.transliterateUtf8(pending, encoded, true);
+        write(out, encoded);
+        if (fflush(out) != 0)
+            throw std::system_error(errno, std::generic_category(), "unable to write output");
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    std::string_view lang;
+    std::string_view mappingName;
+    std::optional<Encoding> encoding;
+    const char * tablePath = nullptr;
+    const char * exportPath = nullptr;
+    const char * path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "translit-cli: %s requires an argument\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        } else if (arg == "--list") {
+            listLanguages();
+            return EXIT_SUCCESS;
+        } else if (arg == "-l" || arg == "--language") {
+            lang = value();
+        } else if (arg == "-m" || arg == "--mapping") {
+            mappingName = value();
+        } else if (arg == "-t" || arg == "--table") {
+            tablePath = value().data();
+        } else if (arg == "--export") {
+            exportPath = value().data();
+        } else if (arg == "-e" || arg == "--encoding") {
+            auto name = value();
+            encoding = parseEncoding(name);
+            if (!encoding) {
+                fprintf(stderr, "translit-cli: unknown encoding %.*s\n", int(name.size()), name.data());
+                return EXIT_FAILURE;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "translit-cli: unknown option %s\n", argv[i]);
+            usage(stderr);
+            return EXIT_FAILURE;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (lang.empty() == !tablePath || (tablePath && exportPath)) {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    const MappingInfo * mapping = nullptr;
+    if (!tablePath) {
+        mapping = findMapping(lang, mappingName);
+        if (!mapping) {
+            fprintf(stderr, "translit-cli: unknown language or mapping, use --list to see available ones\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (exportPath) {
+        try {
+            exportTable(*mapping, exportPath);
+        } catch(std::system_error & ex) {
+            fprintf(stderr, "translit-cli: %s\n", ex.what());
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    std::optional<MappedFile> table;
+    std::optional<FlatMapper<char16_t>> tableMapper;
+    if (tablePath) {
+        try {
+            table.emplace(tablePath);
+            tableMapper.emplace(table->bytes());
+        } catch(std::system_error & ex) {
+            fprintf(stderr, "translit-cli: %s\n", ex.what());
+            return EXIT_FAILURE;
+        } catch(std::runtime_error & ex) {
+            fprintf(stderr, "translit-cli: %s: %s\n", tablePath, ex.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE * in = stdin;
+    if (path && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb");
+        if (!in) {
+            fprintf(stderr, "translit-cli: unable to open %s: %s\n", path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+#ifdef _WIN32
+    if (in == stdin)
+        _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    try {
+        std::vector<unsigned char> buffer(g_chunkSize);
+        auto first = readChunk(in, buffer);
+        if (!encoding)
+            encoding = detectEncoding(first);
+        if (tableMapper)
+            transliterateStream(in, stdout, *tableMapper, *encoding, buffer, first);
+        else if (*encoding == Encoding::utf8)
+            transliterateUtf8Stream(in, stdout, *mapping, buffer, first);
+        else
+            transliterateStream(in, stdout, mapping->mapper, *encoding, buffer, first);
+    } catch(std::system_error & ex) {
+        fprintf(stderr, "translit-cli: %s\n", ex.what());
+        return EXIT_FAILURE;
+    }
+    if (in != stdin)
+        fclose(in);
+    return EXIT_SUCCESS;
+}
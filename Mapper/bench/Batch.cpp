@@ -0,0 +1,158 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+#include <vector>
+
+namespace {
+
+    using Result = PrefixMatchResult<std::u16string_view::iterator>;
+
+    /** prefixMatch() on every string in turn */
+    template<class Matcher>
+    void plainLoop(const Matcher & matcher, std::span<const std::u16string_view> inputs, std::span<Result> results) {
+        for(size_t i = 0; i < inputs.size(); ++i)
+            results[i] = prefixMatch(matcher, inputs[i]);
+    }
+
+    /**
+     prefixMatch() on Lanes strings at once, one character of each per step, so that the
+     dependent transition loads of different strings are issued back to back. A lane that
+     finishes picks up the next string right away. This is the batch matcher that used to
+     be in BatchMatch.hpp.
+     */
+    template<size_t Lanes, class Matcher>
+    void lockstep(const Matcher & matcher, std::span<const std::u16string_view> inputs, std::span<Result> results) {
+        using SizeType = typename Matcher::SizeType;
+        constexpr size_t none = size_t(-1);
+
+        std::array<size_t, Lanes> inputIdx;
+        std::array<const char16_t *, Lanes> current, last, consumed;
+        std::array<SizeType, Lanes> state, matchedState;
+        size_t nextInput = 0;
+        size_t live = 0;
+
+        auto load = [&](size_t lane) {
+            auto input = inputs[nextInput];
+            inputIdx[lane] = nextInput++;
+            current[lane] = input.data();
+            last[lane] = input.data() + input.size();
+            consumed[lane] = input.data();
+            state[lane] = matcher.startState;
+            matchedState[lane] = matcher.noState;
+        };
+
+        for(size_t lane = 0; lane < Lanes; ++lane) {
+            if (nextInput < inputs.size()) {
+                load(lane);
+                ++live;
+            } else {
+                inputIdx[lane] = none;
+            }
+        }
+        while(live) {
+            for(size_t lane = 0; lane < Lanes; ++lane) {
+                if (inputIdx[lane] == none)
+                    continue;
+
+                auto currentState = state[lane];
+                auto currentChar = current[lane];
+                if (matcher.accepts(currentState)) {
+                    consumed[lane] = currentChar;
+                    matchedState[lane] = currentState;
+                }
+                bool final = true;
+                if (currentChar != last[lane]) {
+                    auto inputClass = matcher.inputClass(*currentChar);
+                    if (inputClass != matcher.noClass) {
+                        auto nextState = matcher.next(currentState, inputClass);
+                        if (nextState != matcher.noState) {
+                            state[lane] = nextState;
+                            current[lane] = currentChar + 1;
+                            continue;
+                        }
+                    }
+                } else {
+                    final = false;
+                }
+
+                auto input = inputs[inputIdx[lane]];
+                auto & result = results[inputIdx[lane]];
+                if (matchedState[lane] != matcher.noState) {
+                    auto outcome = matcher.outcome(matchedState[lane]);
+                    result = Result{input.begin() + (consumed[lane] - input.data()), outcome.value(), final || outcome.final()};
+                } else {
+                    result = Result{input.begin(), matcher.noMatch, final || matcher.inputs.size() == 0};
+                }
+
+                if (nextInput < inputs.size()) {
+                    load(lane);
+                } else {
+                    inputIdx[lane] = none;
+                    --live;
+                }
+            }
+        }
+    }
+
+    /** Random strings of 1 to maxLength characters from alphabet, like names or titles */
+    auto randomStrings(std::u16string_view alphabet, size_t maxLength, size_t count) -> std::vector<std::u16string> {
+        std::mt19937 rng(1);
+        std::vector<std::u16string> ret;
+        for(size_t i = 0; i < count; ++i)
+            ret.push_back(randomText(rng, alphabet, 1 + rng() % maxLength));
+        return ret;
+    }
+
+    template<class Matcher>
+    void measureBatch(const char * name, const Matcher & matcher, const std::vector<std::u16string> & strings) {
+        std::vector<std::u16string_view> inputs(strings.begin(), strings.end());
+        std::vector<Result> results(inputs.size());
+        std::vector<Result> expected(inputs.size());
+        plainLoop(matcher, inputs, expected);
+
+        auto run = [&](auto func) {
+            auto time = Bench::measure(inputs.size(), [&]() {
+                func(matcher, inputs, results);
+                Bench::keep(results.back().index);
+            });
+            for(size_t i = 0; i < inputs.size(); ++i) {
+                if (results[i].next != expected[i].next || results[i].index != expected[i].index || results[i].definite != expected[i].definite) {
+                    std::fprintf(stderr, "lockstep result %zu differs from prefixMatch\n", i);
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+            return 1000 / time;
+        };
+        auto plain = run([](auto & m, auto & in, auto & out) { plainLoop(m, in, out); });
+        auto lanes4 = run([](auto & m, auto & in, auto & out) { lockstep<4>(m, in, out); });
+        auto lanes8 = run([](auto & m, auto & in, auto & out) { lockstep<8>(m, in, out); });
+        auto lanes16 = run([](auto & m, auto & in, auto & out) { lockstep<16>(m, in, out); });
+        std::printf("%-24s %8.1f %8.1f %8.1f %8.1f\n", name, plain, lanes4, lanes8, lanes16);
+    }
+}
+
+/**
+ Million strings per second of prefixMatch() over many short strings in a plain loop and
+ interleaved 4, 8 and 16 strings at a time, for the shipped tables and a runtime table too
+ large for the cache
+ */
+BENCHMARK(batchMatch) {
+    std::printf("%-24s %8s %8s %8s %8s\n", "table", "plain", "4 lanes", "8 lanes", "16 lanes");
+    forEachShippedTable([](const char * name, auto mapper) {
+        auto strings = randomStrings(alphabetOf(mapper.matcher, u""), 12, Bench::scaled(200'000));
+        measureBatch(name, mapper.matcher, strings);
+    });
+
+    auto mappings = dictionaryMappings(Bench::scaled(500'000));
+    auto bytes = buildTable(mappings, MatchOptions{.layout = MatchLayout::displaced, .minimize = true});
+    FlatMapper<char16_t> flat(bytes);
+    auto strings = randomStrings(u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя", 8, Bench::scaled(200'000));
+    char name[64];
+    std::snprintf(name, sizeof(name), "runtime %zu KB", bytes.size() / 1024);
+    measureBatch(name, flat.matcher(), strings);
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+/**
+ Minimal self-registering benchmarks
+
+ Every BENCHMARK in any source file of the benchmark executable runs unless a name filter
+ is given on the command line. Each one prints its own results, one measurement per line.
+ */
+namespace Bench {
+
+    struct Case {
+        const char * name;
+        void (*func)();
+        Case * next = nullptr;
+    };
+
+    /** Adds the benchmark to the ones main() runs. Returns true so it can initialize a static */
+    bool add(Case & benchCase) noexcept;
+
+    /** Whether to do a single short run of everything, e.g. to check that benchmarks still work */
+    bool quick() noexcept;
+
+    /** Scales a workload size down in quick mode */
+    inline auto scaled(size_t size) noexcept -> size_t
+        { return quick() ? std::max(size / 100, size_t(1)) : size; }
+
+    /** Keeps the compiler from optimizing away the computation of value */
+    template<class T>
+    inline void keep(const T & value) noexcept {
+    #if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+    #else
+        static volatile const void * sink;
+        sink = &value;
+    #endif
+    }
+
+    /**
+     Runs func a few times and returns the best time it took in ns per item, for items
+     processed by each run. The best rather than average run filters out preemption and
+     cold caches that have nothing to do with what is measured.
+     */
+    template<class Func>
+    auto measure(size_t items, Func && func) -> double {
+        const int runs = quick() ? 1 : 9;
+        func();
+        double best = 0;
+        for(int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || elapsed < best)
+                best = elapsed;
+        }
+        return best / double(items);
+    }
+}
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+#define BENCHMARK(name) \
+    static void name(); \
+    static Bench::Case BENCH_CONCAT(name, Case){#name, name}; \
+    [[maybe_unused]] static const bool BENCH_CONCAT(name, Added) = Bench::add(BENCH_CONCAT(name, Case)); \
+    static void name()
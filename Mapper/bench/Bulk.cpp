@@ -0,0 +1,29 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/BulkTransliterate.hpp>
+
+#include <vector>
+
+/** Throughput of one-pass transliterate() into a BufferSink over a multi-megabyte text of random words */
+BENCHMARK(bulkThroughput) {
+    std::printf("%-16s %12s %12s\n", "table", "input", "throughput");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        using Char = typename Mapper::Char;
+
+        std::mt19937 rng(1);
+        auto text = randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(4'000'000));
+        std::vector<Char> buffer(text.size() * Mapper::maxExpansion);
+
+        auto time = Bench::measure(text.size() * sizeof(Char), [&]() {
+            BufferSink<Char> sink(buffer);
+            transliterate(mapper, text, sink);
+            Bench::keep(sink.size());
+        });
+        std::printf("%-16s %9zu KB %7.0f MB/s\n", name, text.size() * sizeof(Char) / 1024, 1000 / time);
+    });
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <span>
+#include <vector>
+
+namespace {
+
+    /** Matcher that finds input classes by binary search over inputs, as all of them did before class maps */
+    template<class Matcher>
+    struct BinarySearchMatch {
+        using CharType = typename Matcher::CharType;
+        using SizeType = typename Matcher::SizeType;
+        using ClassType = typename Matcher::ClassType;
+
+        static constexpr SizeType noState = Matcher::noState;
+        static constexpr ClassType noClass = Matcher::noClass;
+        static constexpr size_t noMatch = Matcher::noMatch;
+
+        const Matcher & matcher;
+        std::span<const CharType> inputs;
+        SizeType startState;
+        std::vector<ClassType> classes;
+
+        explicit BinarySearchMatch(const Matcher & matcher_):
+            matcher(matcher_),
+            inputs(matcher_.inputs),
+            startState(matcher_.startState) {
+            for(auto c: inputs)
+                classes.push_back(matcher.inputClass(c));
+        }
+
+        auto inputClass(CharType c) const noexcept -> ClassType {
+            auto it = std::lower_bound(inputs.begin(), inputs.end(), c);
+            if (it == inputs.end() || *it != c)
+                return noClass;
+            return classes[size_t(it - inputs.begin())];
+        }
+        auto next(SizeType state, size_t input) const noexcept -> SizeType
+            { return matcher.next(state, input); }
+        bool accepts(SizeType state) const noexcept
+            { return matcher.accepts(state); }
+        auto outcome(SizeType state) const noexcept
+            { return matcher.outcome(state); }
+    };
+}
+
+/** prefixMatch over random text with the class map and with binary search for input classes */
+BENCHMARK(classMapLookup) {
+    std::printf("%-16s %16s %16s\n", "table", "binary search", "class map");
+    forEachShippedTable([](const char * name, auto mapper) {
+        const auto & matcher = mapper.matcher;
+        BinarySearchMatch<std::remove_cvref_t<decltype(matcher)>> searching(matcher);
+
+        std::mt19937 rng(1);
+        auto text = randomText(rng, alphabetOf(matcher), Bench::scaled(1'000'000));
+
+        auto searched = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(searching, text)); });
+        auto mapped = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(matcher, text)); });
+        std::printf("%-16s %8.2f ns/char %8.2f ns/char\n", name, searched, mapped);
+    });
+}
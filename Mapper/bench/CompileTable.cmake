@@ -0,0 +1,43 @@
+# Writes a C++ source that builds a synthetic makePrefixMapper table with count keys.
+# Key i is i written in base 52 with letters for digits so keys share prefixes like real ones do.
+function(mapper_write_compile_table path count)
+    set(alphabet "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ")
+    set(mappings "")
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+        set(key "")
+        set(rest ${i})
+        while(1)
+            math(EXPR digit "${rest} % 52")
+            string(SUBSTRING ${alphabet} ${digit} 1 letter)
+            string(PREPEND key ${letter})
+            math(EXPR rest "${rest} / 52")
+            if (rest EQUAL 0)
+                break()
+            endif()
+        endwhile()
+        math(EXPR dst "0x400 + ${i} % 100" OUTPUT_FORMAT HEXADECIMAL)
+        string(SUBSTRING ${dst} 2 -1 dst)
+        if (i EQUAL last)
+            string(APPEND mappings "    Mapping{u'\\x${dst}', u\"${key}\"}\n")
+        else()
+            string(APPEND mappings "    Mapping{u'\\x${dst}', u\"${key}\"},\n")
+        endif()
+    endforeach()
+    file(WRITE ${path}.tmp
+"// THIS FILE IS AUTO-GENERATED. DO NOT EDIT.
+
+#include <Mapper/Mapper.hpp>
+
+#include <string_view>
+
+constexpr auto g_mapper = makePrefixMapper<std::u16string_view,
+${mappings}>();
+
+auto compileTableSize() -> size_t {
+    return sizeof(g_mapper.matcher);
+}
+")
+    file(COPY_FILE ${path}.tmp ${path} ONLY_IF_DIFFERENT)
+    file(REMOVE ${path}.tmp)
+endfunction()
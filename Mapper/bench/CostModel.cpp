@@ -0,0 +1,128 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "Mappers.h"
+#include "Matchers.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+namespace {
+
+    /** Keys of mappings picked uniformly at random, with a space after about every 6th, about length characters in all */
+    template<class Mappings>
+    auto randomKeys(std::mt19937 & rng, const Mappings & mappings, size_t length) -> std::u16string {
+        std::uniform_int_distribution<size_t> pick(0, mappings.size() - 1);
+        std::uniform_int_distribution<size_t> space(0, 5);
+        std::u16string ret;
+        while(ret.size() < length) {
+            ret += mappings[pick(rng)].second;
+            if (space(rng) == 0)
+                ret += u' ';
+        }
+        return ret;
+    }
+
+    template<class Mapper, MatchEngine Engine>
+    void measureEngine(std::u16string_view text, double & fastest, MatchEngine & fastestEngine) {
+        constexpr auto & candidate = Mapper::matchPlan[Engine];
+        if constexpr (candidate.available) {
+            constexpr auto & matcher = EnginesOf<Mapper>::template matcher<Engine>;
+            auto time = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(matcher, text)); });
+            std::printf(" %6.2f (%5.2f)", time, candidate.cost);
+            if (time < fastest) {
+                fastest = time;
+                fastestEngine = Engine;
+            }
+        } else {
+            std::printf(" %14s", "-");
+        }
+    }
+
+    template<class Mapper>
+    void compareEngines(const char * name, Mapper mapper) {
+        constexpr auto & plan = Mapper::template WithOptions<[]() {
+            auto ret = Mapper::options;
+            ret.selectEngine = true;
+            return ret;
+        }()>::matchPlan;
+
+        std::mt19937 rng(1);
+        auto text = randomKeys(rng, mappingsOf(mapper), Bench::scaled(1'000'000));
+
+        double fastest = std::numeric_limits<double>::max();
+        MatchEngine fastestEngine = MatchEngine::displaced;
+        std::printf("%-16s", name);
+        measureEngine<Mapper, MatchEngine::dense>(text, fastest, fastestEngine);
+        measureEngine<Mapper, MatchEngine::displaced>(text, fastest, fastestEngine);
+        measureEngine<Mapper, MatchEngine::bitParallel>(text, fastest, fastestEngine);
+        measureEngine<Mapper, MatchEngine::direct>(text, fastest, fastestEngine);
+        std::printf(" %12s %12s\n", matchEngineName(plan.engine).data(), matchEngineName(fastestEngine).data());
+    }
+
+    /**
+     Measured time of matcher over text next to the cost MatchCostModel gives for its size, and
+     the miss cost that time implies given the time of a matcher that fits in the cache budget
+     */
+    template<class Matcher>
+    void measureSize(const Matcher & matcher, size_t bytes, double step, std::u16string_view text, double & base) {
+        using Model = Impl::MatchCostModel;
+
+        auto time = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(matcher, text)); });
+        if (bytes <= Model::cacheBudget)
+            base = time;
+        std::printf(" %10zu %6.2f (%5.2f)", bytes, time, Model::cost(step, bytes));
+        if (bytes > Model::cacheBudget && base > 0)
+            std::printf(" %5.2f", (time - base) * double(bytes) / double(bytes - Model::cacheBudget));
+        else
+            std::printf(" %5s", "-");
+    }
+}
+
+/**
+ Measured prefixMatch time over random sequences of keys of every engine that can match a table,
+ next to the cost MatchCostModel predicts for it in parentheses. Then the engine selectEngine
+ picks and the fastest one measured. This is where the steps of MatchCostModel come from: they
+ should keep the order of the measured times, up to MatchCostModel::noise.
+ */
+BENCHMARK(costModel) {
+    std::printf("%-16s %14s %14s %14s %14s %12s %12s\n", "table", "dense", "displaced", "bit-parallel", "direct",
+                "picked", "fastest");
+    forEachShippedTable([](const char * name, auto mapper) {
+        compareEngines(name, mapper);
+    });
+    compareEngines("20 singles", g_singlesMapper);
+}
+
+/**
+ Measured prefixMatch time over random sequences of keys of runtime tables of growing size, as
+ dense rows and displaced, next to the cost MatchCostModel predicts for them in parentheses and
+ the missCost the time implies compared to the largest table within cacheBudget. This is where
+ cacheBudget and missCost come from: the time should start to grow about where the size passes
+ cacheBudget and the implied missCost should stay close to the model's up to the largest tables
+ compiled mappers are built for.
+ */
+BENCHMARK(cacheBudget) {
+    using Model = Impl::MatchCostModel;
+
+    std::printf("%-6s %10s %14s %5s %10s %14s %5s\n", "keys", "dense", "time (model)", "miss", "displaced", "time (model)", "miss");
+    double denseBase = 0, displacedBase = 0;
+    for(size_t count = 2; count <= 16'384; count *= 2) {
+        auto mappings = dictionaryMappings(count);
+        auto bytes = buildTable(mappings, MatchOptions{.layout = MatchLayout::displaced, .minimize = true});
+        FlatMapper<char16_t> flat(bytes);
+        auto & displaced = flat.matcher();
+        BenchMatchers::PlainMatch<std::remove_cvref_t<decltype(displaced)>, uint32_t> dense(displaced);
+
+        std::mt19937 rng(1);
+        auto text = randomKeys(rng, mappings, Bench::scaled(1'000'000));
+        if (greedyPass(dense, text) != greedyPass(displaced, text)) {
+            std::fprintf(stderr, "%zu keys: matchers disagree\n", count);
+            std::exit(EXIT_FAILURE);
+        }
+        std::printf("%-6zu", count);
+        measureSize(dense, dense.bytes(), Model::denseStep, text, denseBase);
+        measureSize(displaced, bytes.size(), Model::displacedStep, text, displacedBase);
+        std::printf("\n");
+    }
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/VariantTransliterator.hpp>
+
+namespace {
+
+    using StringView = TransliteratorTypes::StringView;
+
+    /** Variant over every shipped table, as the IME would hold */
+    using ShippedTransliterator = VariantTransliterator<
+        decltype(g_mapperBeDefault<TableRange>),
+        decltype(g_mapperBeTranslitRu<TableRange>),
+        decltype(g_mapperHeDefault<TableRange>),
+        decltype(g_mapperRuDefault<TableRange>),
+        decltype(g_mapperRuTranslitRu<TableRange>),
+        decltype(g_mapperUkDefault<TableRange>),
+        decltype(g_mapperUkTranslitRu<TableRange>)
+    >;
+
+    /** Types text one character at a time, dropping completed output as an IME would */
+    template<class T>
+    auto typeKeys(T & transliterator, std::u16string_view text) -> size_t {
+        transliterator.clear();
+        size_t ret = 0;
+        for(auto c: text) {
+            transliterator.append(StringView(&c, 1));
+            ret += transliterator.completedSize();
+            transliterator.clearCompleted();
+        }
+        transliterator.finish();
+        return ret + transliterator.result().size();
+    }
+
+    /** Appends the whole text at once */
+    template<class T>
+    auto appendAll(T & transliterator, std::u16string_view text) -> size_t {
+        transliterator.clear();
+        transliterator.append(text);
+        transliterator.finish();
+        return transliterator.result().size();
+    }
+
+    template<class T>
+    void measureDispatch(const char * name, T & transliterator, std::u16string_view text) {
+        auto keystroke = Bench::measure(text.size(), [&]() { Bench::keep(typeKeys(transliterator, text)); });
+        auto bulk = Bench::measure(text.size() * sizeof(char16_t), [&]() { Bench::keep(appendAll(transliterator, text)); });
+        std::printf("  %-26s %8.2f ns/key %7.0f MB/s\n", name, keystroke, 1000 / bulk);
+    }
+}
+
+/**
+ Transliterator calling the mapper through a function pointer, BasicTransliterator specialized
+ on the table and VariantTransliterator dispatching over all tables once per call
+ */
+BENCHMARK(mapperDispatch) {
+    std::printf("%-28s %16s %12s\n", "table", "keystroke", "bulk");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+
+        std::mt19937 rng(1);
+        auto text = randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(1'000'000));
+
+        Transliterator pointer(mapper);
+        BasicTransliterator<Mapper> specialized(mapper);
+        ShippedTransliterator variant(mapper);
+
+        std::printf("%s\n", name);
+        measureDispatch("function pointer", pointer, text);
+        measureDispatch("specialized", specialized, text);
+        measureDispatch("variant", variant, text);
+    });
+}
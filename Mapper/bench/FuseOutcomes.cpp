@@ -0,0 +1,127 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "Matchers.h"
+#include "../test/Tables.h"
+
+#include <bit>
+#include <vector>
+
+namespace {
+
+    /**
+     The encoding MatchOptions::fuseOutcomes used: every cell holds the target state index, its
+     payload, an accepting bit and a final bit so that reaching a state gives its outcome without
+     another load
+     */
+    template<class Matcher, class State>
+    struct FusedMatch {
+        using CharType = typename Matcher::CharType;
+        using SizeType = State;
+        using ClassType = typename Matcher::ClassType;
+        using OutcomeType = Impl::Outcome<State>;
+
+        static constexpr SizeType noState = SizeType(-1);
+        static constexpr ClassType noClass = Matcher::noClass;
+
+        const Matcher * original;
+        std::span<const CharType> inputs;
+        size_t noMatch;
+        size_t rowSize;
+        int indexShift;
+        SizeType payloadMask;
+        SizeType startState;
+        std::vector<State> cells;
+
+        explicit FusedMatch(const Matcher & matcher):
+            original(&matcher),
+            inputs(matcher.inputs),
+            noMatch(matcher.noMatch) {
+
+            BenchMatchers::Reachable reachable(matcher);
+            rowSize = reachable.classes.back() + 1;
+            int payloadBits = std::bit_width(matcher.noMatch);
+            indexShift = 2 + payloadBits;
+            payloadMask = SizeType((SizeType(1) << payloadBits) - 1);
+            if (indexShift + std::bit_width(reachable.states) > int(sizeof(State) * CHAR_BIT))
+                throw std::length_error("states don't fit");
+
+            auto value = [&](size_t state) {
+                SizeType ret = SizeType(state) << indexShift;
+                if (matcher.accepts(typename Matcher::SizeType(state))) {
+                    auto outcome = matcher.outcome(typename Matcher::SizeType(state));
+                    ret |= SizeType(outcome.value()) << 2 | 2 | SizeType(outcome.final());
+                }
+                return ret;
+            };
+            startState = value(matcher.startState);
+            cells.resize(reachable.states * rowSize, noState);
+            for(size_t state = 0; state < reachable.states; ++state) {
+                for(auto cls: reachable.classes) {
+                    auto next = matcher.next(typename Matcher::SizeType(state), cls);
+                    if (next != matcher.noState)
+                        cells[state * rowSize + cls] = value(next);
+                }
+            }
+        }
+
+        auto inputClass(CharType c) const noexcept -> ClassType
+            { return original->inputClass(c); }
+        auto next(SizeType state, size_t input) const noexcept -> SizeType
+            { return cells[(state >> indexShift) * rowSize + input]; }
+        auto accepts(SizeType state) const noexcept -> bool
+            { return state & 2; }
+        auto outcome(SizeType state) const noexcept -> OutcomeType
+            { return OutcomeType((state >> 2) & payloadMask, state & 1); }
+        auto bytes() const noexcept -> size_t
+            { return cells.size() * sizeof(State); }
+    };
+
+    template<class Matcher>
+    auto measurePass(const Matcher & matcher, std::u16string_view text) -> double {
+        return Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(matcher, text)); });
+    }
+}
+
+/**
+ Greedy longest-match passes over random words with the compiled matcher, the same automaton as
+ dense rows of the narrowest state type with a separate outcomes array, and as dense rows of
+ fused values as MatchOptions::fuseOutcomes had them. Times per character and table sizes.
+ */
+BENCHMARK(fuseOutcomes) {
+    std::printf("%-16s %12s %22s %22s\n", "table", "compiled", "plain", "fused");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Matcher = std::remove_cvref_t<decltype(mapper.matcher)>;
+
+        std::mt19937 rng(1);
+        auto text = randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(2'000'000));
+
+        auto expected = greedyPass(mapper.matcher, text);
+        auto check = [&](const auto & matcher) {
+            if (greedyPass(matcher, text) != expected) {
+                std::fprintf(stderr, "%s: matchers disagree\n", name);
+                std::exit(EXIT_FAILURE);
+            }
+            return measurePass(matcher, text);
+        };
+
+        auto compiled = measurePass(mapper.matcher, text);
+        BenchMatchers::PlainMatch<Matcher, typename Matcher::SizeType> plain(mapper.matcher);
+        auto plainTime = check(plain);
+        //the narrowest state type the fused values fit in
+        double fusedTime;
+        size_t fusedBytes;
+        try {
+            FusedMatch<Matcher, uint16_t> fused(mapper.matcher);
+            fusedTime = check(fused);
+            fusedBytes = fused.bytes();
+        } catch(std::length_error &) {
+            FusedMatch<Matcher, uint32_t> fused(mapper.matcher);
+            fusedTime = check(fused);
+            fusedBytes = fused.bytes();
+        }
+        std::printf("%-16s %6.2f ns/ch %6.2f ns/ch %7zu B %6.2f ns/ch %7zu B\n", name,
+                    compiled, plainTime, plain.bytes(), fusedTime, fusedBytes);
+    });
+}
@@ -0,0 +1,236 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "Matchers.h"
+#include "../test/Tables.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+    using StringView = TransliteratorTypes::StringView;
+
+    /** Types keys one character at a time, dropping completed output as an IME would */
+    template<class Mapper, PrefixMatching Matching>
+    auto typeKeys(std::u16string_view keys) -> size_t {
+        BasicTransliterator<Mapper, Matching> transliterator;
+        size_t ret = 0;
+        for(auto c: keys) {
+            transliterator.append(StringView(&c, 1));
+            ret += transliterator.completedSize();
+            transliterator.clearCompleted();
+        }
+        transliterator.finish();
+        return ret + transliterator.result().size();
+    }
+
+    template<class Mapper>
+    void compareKeystrokes(const char * name, std::u16string_view keys) {
+        auto rescanning = Bench::measure(keys.size(), [&]() { Bench::keep(typeKeys<Mapper, PrefixMatching::rescan>(keys)); });
+        auto resuming = Bench::measure(keys.size(), [&]() { Bench::keep(typeKeys<Mapper, PrefixMatching::resume>(keys)); });
+        std::printf("%-28s %8.2f ns/key %8.2f ns/key\n", name, rescanning, resuming);
+    }
+
+    auto repeat(std::u16string_view pattern, size_t length) -> std::u16string {
+        std::u16string ret;
+        ret.reserve(length);
+        while(ret.size() < length)
+            ret += pattern;
+        return ret;
+    }
+
+    /** About length characters of keys picked with Zipf weights, a few at a time between spaces */
+    template<class Mappings>
+    auto zipfKeys(const Mappings & mappings, size_t length) -> std::u16string {
+        std::mt19937 rng(1);
+        std::vector<std::u16string_view> keys;
+        for(auto & [dst, src]: mappings)
+            keys.push_back(src);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        std::vector<double> weights(keys.size());
+        for(size_t i = 0; i < weights.size(); ++i)
+            weights[i] = 1.0 / double(i + 1);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+        std::u16string ret;
+        while(ret.size() < length) {
+            for(size_t count = 1 + rng() % 4; count; --count)
+                ret += keys[pick(rng)];
+            ret += u' ';
+        }
+        return ret;
+    }
+
+    /**
+     The numbering MatchOptions::breadthFirst gave: states in the order a breadth first search
+     from the start state reaches them, inputs in class order, with accepting states still first
+     */
+    template<class Matcher>
+    auto breadthFirstNumbering(const Matcher & matcher) -> std::vector<size_t> {
+        BenchMatchers::Reachable reachable(matcher);
+        std::vector<size_t> order{matcher.startState};
+        std::vector<bool> seen(reachable.states);
+        seen[matcher.startState] = true;
+        for(size_t i = 0; i < order.size(); ++i) {
+            for(auto cls: reachable.classes) {
+                auto next = matcher.next(typename Matcher::SizeType(order[i]), cls);
+                if (next != matcher.noState && !seen[next]) {
+                    seen[next] = true;
+                    order.push_back(next);
+                }
+            }
+        }
+
+        auto accepts = [&](size_t state) { return matcher.accepts(typename Matcher::SizeType(state)); };
+        std::vector<size_t> ret(reachable.states);
+        size_t nextAccepting = 0;
+        size_t nextOther = 0;
+        for(size_t state = 0; state < reachable.states; ++state)
+            nextOther += accepts(state);
+        for(auto state: order)
+            ret[state] = (accepts(state) ? nextAccepting++ : nextOther++);
+        return ret;
+    }
+
+    template<class Matcher, class Mappings>
+    void compareNumberings(const char * name, const Matcher & matcher, const Mappings & mappings) {
+        using State = typename Matcher::SizeType;
+        auto keys = zipfKeys(mappings, Bench::scaled(2'000'000));
+        auto expected = keystrokePass(matcher, keys);
+
+        auto measure = [&](const auto & replayed) {
+            if (keystrokePass(replayed, keys) != expected) {
+                std::fprintf(stderr, "%s: numberings disagree\n", name);
+                std::exit(EXIT_FAILURE);
+            }
+            return Bench::measure(keys.size(), [&]() { Bench::keep(keystrokePass(replayed, keys)); });
+        };
+        auto built = measure(matcher);
+        BenchMatchers::PlainMatch<Matcher, State> original(matcher);
+        BenchMatchers::PlainMatch<Matcher, State> breadthFirst(matcher, breadthFirstNumbering(matcher));
+        auto originalTime = measure(original);
+        auto breadthFirstTime = measure(breadthFirst);
+        std::printf("%-20s %6.2f ns/key %6.2f ns/key %6.2f ns/key %10zu B\n", name,
+                    built, originalTime, breadthFirstTime, original.bytes());
+    }
+
+    /** Forwards to matcher counting transition lookups and the ones that lead nowhere */
+    template<class Matcher>
+    struct CountingMatch {
+        using CharType = typename Matcher::CharType;
+        using SizeType = typename Matcher::SizeType;
+        using ClassType = typename Matcher::ClassType;
+
+        static constexpr SizeType noState = Matcher::noState;
+        static constexpr ClassType noClass = Matcher::noClass;
+
+        const Matcher * original;
+        std::span<const CharType> inputs;
+        size_t noMatch;
+        SizeType startState;
+        mutable size_t lookups = 0;
+        mutable size_t deadEnds = 0;
+
+        explicit CountingMatch(const Matcher & matcher):
+            original(&matcher),
+            inputs(matcher.inputs),
+            noMatch(matcher.noMatch),
+            startState(matcher.startState) {
+        }
+
+        auto inputClass(CharType c) const noexcept -> ClassType
+            { return original->inputClass(c); }
+        auto next(SizeType state, size_t input) const noexcept -> SizeType {
+            auto ret = original->next(state, input);
+            ++lookups;
+            deadEnds += (ret == noState);
+            return ret;
+        }
+        auto accepts(SizeType state) const noexcept -> bool
+            { return original->accepts(state); }
+        auto outcome(SizeType state) const noexcept
+            { return original->outcome(state); }
+    };
+
+    template<class Matcher, class Mappings>
+    void compareMasks(const char * name, const Matcher & matcher, size_t tableBytes, const Mappings & mappings) {
+        auto keys = zipfKeys(mappings, Bench::scaled(2'000'000));
+        CountingMatch counting(matcher);
+        auto expected = keystrokePass(counting, keys);
+
+        BenchMatchers::MaskedMatch masked(matcher);
+        if (keystrokePass(masked, keys) != expected) {
+            std::fprintf(stderr, "%s: masked matcher disagrees\n", name);
+            std::exit(EXIT_FAILURE);
+        }
+        auto plainTime = Bench::measure(keys.size(), [&]() { Bench::keep(keystrokePass(matcher, keys)); });
+        auto maskedTime = Bench::measure(keys.size(), [&]() { Bench::keep(keystrokePass(masked, keys)); });
+        std::printf("%-20s %5.1f%% %10zu B %10zu B %6.2f ns/key %6.2f ns/key\n", name,
+                    100.0 * double(counting.deadEnds) / double(counting.lookups), tableBytes, masked.maskBytes(),
+                    plainTime, maskedTime);
+    }
+
+    /** A key that is pending for 31 characters and stays ambiguous till its end */
+    constexpr auto g_longKeyMapper = makePrefixMapper<TableRange,
+        Mapping{u'1', u"a"},
+        Mapping{u'2', u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"}
+    >();
+}
+
+/** Cost per keystroke of re-matching the whole pending prefix and of resuming from a cursor */
+BENCHMARK(keystroke) {
+    std::printf("%-28s %16s %16s\n", "keys", "rescanning", "resuming");
+    const size_t length = Bench::scaled(200'000);
+    using He = decltype(g_mapperHeDefault<TableRange>);
+    compareKeystrokes<He>("he EAAE", repeat(u"EAAE", length));
+    compareKeystrokes<He>("he EAA EEE shalom", repeat(u"EAA EEE shalom ", length));
+    compareKeystrokes<decltype(g_mapperRuDefault<TableRange>)>("ru privet", repeat(u"privet, mir! ", length));
+    compareKeystrokes<decltype(g_longKeyMapper)>("31 pending characters", repeat(u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa ", length));
+}
+
+/**
+ Cost per keystroke of resuming matches over Zipf distributed keys with the table as built, and
+ with its states in dense rows numbered as built and breadth first as MatchOptions::breadthFirst
+ had them, for the shipped tables and runtime tables too large for the cache
+ */
+BENCHMARK(breadthFirstKeystroke) {
+    std::printf("%-20s %13s %13s %13s %12s\n", "table", "as built", "original", "breadth first", "dense size");
+    forEachShippedTable([](const char * name, auto mapper) {
+        compareNumberings(name, mapper.matcher, mappingsOf(mapper));
+    });
+
+    for(size_t count: {Bench::scaled(20'000), Bench::scaled(200'000)}) {
+        auto mappings = dictionaryMappings(count);
+        auto bytes = buildTable(mappings, MatchOptions{.layout = MatchLayout::displaced, .minimize = true});
+        FlatMapper<char16_t> flat(bytes);
+        char name[64];
+        std::snprintf(name, sizeof(name), "runtime %zu keys", count);
+        compareNumberings(name, flat.matcher(), mappings);
+    }
+}
+
+/**
+ Cost per keystroke of resuming matches over Zipf distributed keys with the table as built and
+ with the per-state input masks MatchOptions::inputMasks had in front of it. Shows the share of
+ transition lookups that lead nowhere, which are the ones masks answer, and the bytes of the
+ transitions and of the masks for the shipped tables and runtime tables too large for the cache.
+ */
+BENCHMARK(inputMasksKeystroke) {
+    std::printf("%-20s %6s %12s %12s %13s %13s\n", "table", "dead", "table size", "mask size", "plain", "masked");
+    forEachShippedTable([](const char * name, auto mapper) {
+        compareMasks(name, mapper.matcher, sizeof(mapper.matcher), mappingsOf(mapper));
+    });
+
+    for(size_t count: {Bench::scaled(20'000), Bench::scaled(200'000), Bench::scaled(1'000'000)}) {
+        auto mappings = dictionaryMappings(count);
+        auto bytes = buildTable(mappings, MatchOptions{.layout = MatchLayout::displaced, .minimize = true});
+        FlatMapper<char16_t> flat(bytes);
+        char name[64];
+        std::snprintf(name, sizeof(name), "runtime %zu keys", count);
+        compareMasks(name, flat.matcher(), bytes.size(), mappings);
+    }
+}
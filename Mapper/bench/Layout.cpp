@@ -0,0 +1,39 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+namespace {
+
+    /** Options of a shipped table with the given layout and no engine selection */
+    consteval auto layoutOptions(MatchOptions options, MatchLayout layout) -> MatchOptions {
+        options.layout = layout;
+        options.selectEngine = false;
+        return options;
+    }
+}
+
+/**
+ Size of each shipped table and prefixMatch over random text in both layouts.
+ Sizes are of the whole MultiMatch and, in parentheses, of its transitions alone.
+ */
+BENCHMARK(transitionLayout) {
+    std::printf("%-16s %6s %6s %16s %16s %16s %16s\n", "table", "inputs", "states",
+                "dense bytes", "displaced bytes", "dense", "displaced");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        constexpr auto & dense = Mapper::template WithOptions<layoutOptions(Mapper::options, MatchLayout::dense)>::matcher;
+        constexpr auto & displaced = Mapper::template WithOptions<layoutOptions(Mapper::options, MatchLayout::displaced)>::matcher;
+
+        std::mt19937 rng(1);
+        auto text = randomText(rng, alphabetOf(dense), Bench::scaled(1'000'000));
+
+        auto denseTime = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(dense, text)); });
+        auto displacedTime = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(displaced, text)); });
+        std::printf("%-16s %6zu %6zu %7zu (%6zu) %7zu (%6zu) %8.2f ns/char %8.2f ns/char\n", name,
+                    dense.inputs.size(), displaced.transitions.bases.size(),
+                    sizeof(dense), sizeof(dense.transitions), sizeof(displaced), sizeof(displaced.transitions),
+                    denseTime, displacedTime);
+    });
+}
@@ -0,0 +1,14 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "../test/Tables.h"
+
+/** Single characters only, so that every engine can match it, and the smallest Shift-And state */
+inline constexpr auto g_singlesMapper = makePrefixMapper<TableRange,
+    Mapping{u'а', u"a"}, Mapping{u'б', u"b"}, Mapping{u'ц', u"c"}, Mapping{u'д', u"d"}, Mapping{u'е', u"e"},
+    Mapping{u'ф', u"f"}, Mapping{u'г', u"g"}, Mapping{u'х', u"h"}, Mapping{u'и', u"i"}, Mapping{u'й', u"j"},
+    Mapping{u'к', u"k"}, Mapping{u'л', u"l"}, Mapping{u'м', u"m"}, Mapping{u'н', u"n"}, Mapping{u'о', u"o"},
+    Mapping{u'п', u"p"}, Mapping{u'я', u"q"}, Mapping{u'р', u"r"}, Mapping{u'с', u"s"}, Mapping{u'т', u"t"}
+>();
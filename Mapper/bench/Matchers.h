@@ -0,0 +1,185 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <Mapper/MultiMatch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+/**
+ Matchers the benchmarks build from an existing one to time alternatives to the library's own
+ layouts. They work with prefixMatch(), resumeMatch() and match() and give the same results as
+ the matcher they are built from.
+ */
+namespace BenchMatchers {
+
+    /** Every state reachable from the start of matcher and the distinct input classes */
+    template<class Matcher>
+    struct Reachable {
+        std::vector<size_t> classes;
+        size_t states = 0;
+
+        explicit Reachable(const Matcher & matcher) {
+            for(auto c: matcher.inputs)
+                classes.push_back(matcher.inputClass(c));
+            std::sort(classes.begin(), classes.end());
+            classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+
+            std::vector<size_t> queue{matcher.startState};
+            std::vector<bool> seen;
+            auto visit = [&](size_t state) {
+                if (state >= seen.size())
+                    seen.resize(state + 1);
+                if (!seen[state]) {
+                    seen[state] = true;
+                    queue.push_back(state);
+                }
+            };
+            visit(matcher.startState);
+            while(!queue.empty()) {
+                auto state = queue.back();
+                queue.pop_back();
+                for(auto cls: classes) {
+                    auto next = matcher.next(typename Matcher::SizeType(state), cls);
+                    if (next != matcher.noState)
+                        visit(next);
+                }
+            }
+            states = seen.size();
+        }
+    };
+
+    /** The numbering a matcher already has: every state keeps its index */
+    template<class Matcher>
+    auto originalNumbering(const Matcher & matcher) -> std::vector<size_t> {
+        std::vector<size_t> ret(Reachable<Matcher>(matcher).states);
+        std::iota(ret.begin(), ret.end(), size_t(0));
+        return ret;
+    }
+
+    /**
+     Dense rows of State indexed by input class. Accepting states are the ones below the number of
+     outcomes, whose payloads and final flags are read from a separate array as MultiMatch does.
+
+     numbering[i] is the index original state i gets. It must keep accepting states below all the
+     others.
+     */
+    template<class Matcher, class State>
+    struct PlainMatch {
+        using CharType = typename Matcher::CharType;
+        using SizeType = State;
+        using ClassType = typename Matcher::ClassType;
+        using OutcomeType = Impl::Outcome<State>;
+
+        static constexpr SizeType noState = SizeType(-1);
+        static constexpr ClassType noClass = Matcher::noClass;
+
+        const Matcher * original;
+        std::span<const CharType> inputs;
+        size_t noMatch;
+        size_t rowSize;
+        SizeType startState;
+        std::vector<State> cells;
+        std::vector<OutcomeType> outcomes;
+
+        explicit PlainMatch(const Matcher & matcher):
+            PlainMatch(matcher, originalNumbering(matcher)) {
+        }
+
+        PlainMatch(const Matcher & matcher, std::span<const size_t> numbering):
+            original(&matcher),
+            inputs(matcher.inputs),
+            noMatch(matcher.noMatch),
+            startState(SizeType(numbering[matcher.startState])) {
+
+            Reachable reachable(matcher);
+            rowSize = reachable.classes.back() + 1;
+            cells.resize(reachable.states * rowSize, noState);
+            for(size_t state = 0; state < reachable.states; ++state) {
+                auto row = numbering[state] * rowSize;
+                for(auto cls: reachable.classes) {
+                    auto next = matcher.next(typename Matcher::SizeType(state), cls);
+                    if (next != matcher.noState)
+                        cells[row + cls] = State(numbering[next]);
+                }
+                if (matcher.accepts(typename Matcher::SizeType(state))) {
+                    auto outcome = matcher.outcome(typename Matcher::SizeType(state));
+                    auto index = numbering[state];
+                    if (index >= outcomes.size())
+                        outcomes.resize(index + 1);
+                    outcomes[index] = OutcomeType(State(outcome.value()), outcome.final());
+                }
+            }
+        }
+
+        auto inputClass(CharType c) const noexcept -> ClassType
+            { return original->inputClass(c); }
+        auto next(SizeType state, size_t input) const noexcept -> SizeType
+            { return cells[state * rowSize + input]; }
+        auto accepts(SizeType state) const noexcept -> bool
+            { return state < outcomes.size(); }
+        auto outcome(SizeType state) const noexcept -> OutcomeType
+            { return outcomes[state]; }
+        auto bytes() const noexcept -> size_t
+            { return cells.size() * sizeof(State) + outcomes.size() * sizeof(OutcomeType); }
+    };
+
+    /**
+     The matcher with the bitset per state MatchOptions::inputMasks kept: a bit per input class set
+     if the state has a transition on it. next() tests the bit first and only looks at the
+     transitions of the matcher if it is set.
+     */
+    template<class Matcher>
+    struct MaskedMatch {
+        using CharType = typename Matcher::CharType;
+        using SizeType = typename Matcher::SizeType;
+        using ClassType = typename Matcher::ClassType;
+
+        static constexpr SizeType noState = Matcher::noState;
+        static constexpr ClassType noClass = Matcher::noClass;
+        static constexpr size_t maskBits = 64;
+
+        const Matcher * original;
+        std::span<const CharType> inputs;
+        size_t noMatch;
+        SizeType startState;
+        size_t maskWords;
+        std::vector<uint64_t> masks;
+
+        explicit MaskedMatch(const Matcher & matcher):
+            original(&matcher),
+            inputs(matcher.inputs),
+            noMatch(matcher.noMatch),
+            startState(matcher.startState) {
+
+            Reachable reachable(matcher);
+            maskWords = (reachable.classes.back() + maskBits) / maskBits;
+            masks.resize(reachable.states * maskWords);
+            for(size_t state = 0; state < reachable.states; ++state) {
+                for(auto cls: reachable.classes) {
+                    if (matcher.next(SizeType(state), cls) != matcher.noState)
+                        masks[state * maskWords + cls / maskBits] |= uint64_t(1) << (cls % maskBits);
+                }
+            }
+        }
+
+        auto inputClass(CharType c) const noexcept -> ClassType
+            { return original->inputClass(c); }
+        auto next(SizeType state, size_t input) const noexcept -> SizeType {
+            if (!((masks[state * maskWords + input / maskBits] >> (input % maskBits)) & 1))
+                return noState;
+            return original->next(state, input);
+        }
+        auto accepts(SizeType state) const noexcept -> bool
+            { return original->accepts(state); }
+        auto outcome(SizeType state) const noexcept
+            { return original->outcome(state); }
+        auto maskBytes() const noexcept -> size_t
+            { return masks.size() * sizeof(uint64_t); }
+    };
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <set>
+
+namespace {
+
+    /** Options of a shipped table with the given layout, input merging and no engine selection */
+    consteval auto mergeOptions(MatchOptions options, MatchLayout layout, bool mergeInputs) -> MatchOptions {
+        options.layout = layout;
+        options.mergeInputs = mergeInputs;
+        options.selectEngine = false;
+        return options;
+    }
+
+    /** Number of transition columns: distinct classes of the inputs */
+    template<class Matcher>
+    auto columnsOf(const Matcher & matcher) -> size_t {
+        std::set<size_t> classes;
+        for(auto c: matcher.inputs)
+            classes.insert(size_t(matcher.inputClass(c)));
+        return classes.size();
+    }
+
+    template<class Mapper, MatchLayout Layout>
+    void compareMerging(const char * name, const char * layoutName) {
+        constexpr auto & unmerged = Mapper::template WithOptions<mergeOptions(Mapper::options, Layout, false)>::matcher;
+        constexpr auto & merged = Mapper::template WithOptions<mergeOptions(Mapper::options, Layout, true)>::matcher;
+
+        std::mt19937 rng(1);
+        auto text = randomText(rng, alphabetOf(unmerged), Bench::scaled(1'000'000));
+
+        auto unmergedTime = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(unmerged, text)); });
+        auto mergedTime = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(merged, text)); });
+        std::printf("%-16s %-10s %4zu -> %4zu %6zu -> %6zu %6.2f -> %6.2f ns/char\n", name, layoutName,
+                    columnsOf(unmerged), columnsOf(merged), sizeof(unmerged), sizeof(merged), unmergedTime, mergedTime);
+    }
+}
+
+/** Transition columns, whole matcher size and prefixMatch speed of each shipped table without and with mergeInputs */
+BENCHMARK(mergeInputs) {
+    std::printf("%-16s %-10s %12s %16s %24s\n", "table", "layout", "columns", "bytes", "speed");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        compareMerging<Mapper, MatchLayout::dense>(name, "dense");
+        compareMerging<Mapper, MatchLayout::displaced>(name, "displaced");
+    });
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <vector>
+
+namespace {
+
+    /**
+     Same mapper with one more mapping whose output is two characters, so all outputs go
+     into an OutputPool. Its key is a control character that random words never contain.
+     */
+    template<class Mapper>
+    struct PooledOutputs;
+
+    template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+    struct PooledOutputs<PrefixMapper<Range, Options, First, Rest...>> {
+        using type = PrefixMapper<Range, Options, First, Rest..., Mapping{u"\x1\x1", u"\x1"}>;
+    };
+
+    /**
+     Longest matches one after another writing each output to out. With chars it writes
+     single characters from a plain array as before text outputs, otherwise it copies the
+     string views from Mapper::mappings.
+     */
+    template<class Mapper, bool Chars>
+    auto outputLoop(std::u16string_view in, char16_t * out) -> size_t {
+        constexpr auto & matcher = Mapper::matcher;
+
+        auto start = out;
+        const auto end = in.data() + in.size();
+        for(auto current = in.data(); current != end; ) {
+            auto res = prefixMatch(matcher, std::ranges::subrange(current, end));
+            if (res.index != matcher.noMatch) {
+                if constexpr (Chars) {
+                    *out++ = Mapper::mappings.chars[res.index];
+                } else {
+                    auto output = Mapper::mappings[res.index];
+                    out = std::copy(output.begin(), output.end(), out);
+                }
+                current = res.next;
+            } else {
+                *out++ = *current++;
+            }
+        }
+        return size_t(out - start);
+    }
+}
+
+/**
+ The same matching loop over tables with only single character outputs writing from a plain
+ character array, as before text outputs, from SingleCharOutputs views and from OutputPool views
+ */
+BENCHMARK(singleCharOutputs) {
+    std::printf("%-16s %12s %12s %12s\n", "table", "char array", "single char", "pool");
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        using Pooled = typename PooledOutputs<Mapper>::type;
+
+        std::mt19937 rng(1);
+        auto text = randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(4'000'000));
+        std::vector<char16_t> buffer(text.size() * Pooled::maxExpansion);
+
+        const size_t bytes = text.size() * sizeof(char16_t);
+        auto array = Bench::measure(bytes, [&]() { Bench::keep(outputLoop<Mapper, true>(text, buffer.data())); });
+        auto single = Bench::measure(bytes, [&]() { Bench::keep(outputLoop<Mapper, false>(text, buffer.data())); });
+        auto pool = Bench::measure(bytes, [&]() { Bench::keep(outputLoop<Pooled, false>(text, buffer.data())); });
+        std::printf("%-16s %7.0f MB/s %7.0f MB/s %7.0f MB/s\n", name, 1000 / array, 1000 / single, 1000 / pool);
+    });
+}
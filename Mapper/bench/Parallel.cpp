@@ -0,0 +1,41 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/ParallelTransliterate.hpp>
+
+#include <vector>
+
+/**
+ Throughput of multi-threaded transliterate() from 1 thread to the number of hardware threads.
+ Doubles the count each step and always includes the hardware count itself.
+ */
+BENCHMARK(parallelScaling) {
+    using Mapper = decltype(g_mapperRuDefault<TableRange>);
+    using Char = Mapper::Char;
+    constexpr auto & mapper = g_mapperRuDefault<TableRange>;
+
+    std::mt19937 rng(1);
+    auto text = randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(64'000'000));
+    std::vector<Char> buffer(text.size() * Mapper::maxExpansion);
+
+    std::vector<unsigned> counts;
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    for(unsigned threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    std::printf("ru, %zu MB of input\n", text.size() * sizeof(Char) / (1024 * 1024));
+    std::printf("%8s %12s %8s\n", "threads", "throughput", "speedup");
+    double single = 0;
+    for(auto threads: counts) {
+        auto time = Bench::measure(text.size() * sizeof(Char), [&]() {
+            Bench::keep(transliterate(mapper, text, buffer, ParallelOptions{.threads = threads}));
+        });
+        if (threads == 1)
+            single = time;
+        std::printf("%8u %7.0f MB/s %7.2fx\n", threads, 1000 / time, single / time);
+    }
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "Mappers.h"
+
+namespace {
+
+    /** Displaced MultiMatch of a mapper's strings with its other options and no engine selection */
+    consteval auto displacedOptions(MatchOptions options) -> MatchOptions {
+        options.layout = MatchLayout::displaced;
+        options.selectEngine = false;
+        return options;
+    }
+
+    template<class Mapper>
+    void compareShiftAnd(const char * name, Mapper) {
+        constexpr auto & displaced = Mapper::template WithOptions<displacedOptions(Mapper::options)>::matcher;
+        constexpr size_t bits = Mapper::matchPlan.stats.shiftAndBits;
+
+        std::mt19937 rng(1);
+        auto text = randomText(rng, alphabetOf(displaced), Bench::scaled(1'000'000));
+
+        auto bulk = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(displaced, text)); });
+        auto keys = Bench::measure(text.size(), [&]() { Bench::keep(keystrokePass(displaced, text)); });
+        std::printf("%-16s %4zu %6zu %8.2f ns/char %8.2f ns/char", name, bits, sizeof(displaced), bulk, keys);
+        if constexpr (bits <= Impl::maxShiftAndBits) {
+            constexpr auto & shiftAnd = EnginesOf<Mapper>::template matcher<MatchEngine::bitParallel>;
+            bulk = Bench::measure(text.size(), [&]() { Bench::keep(greedyPass(shiftAnd, text)); });
+            keys = Bench::measure(text.size(), [&]() { Bench::keep(keystrokePass(shiftAnd, text)); });
+            std::printf(" %6zu %8.2f ns/char %8.2f ns/char\n", sizeof(shiftAnd), bulk, keys);
+        } else {
+            std::printf(" %6s\n", "-");
+        }
+    }
+
+    /** Lowercase Russian letters typed in Latin, short enough for Shift-And */
+    constexpr auto g_ruLowerMapper = makePrefixMapper<TableRange,
+        Mapping{u'а', u"a"}, Mapping{u'б', u"b"}, Mapping{u'в', u"v"}, Mapping{u'г', u"g"}, Mapping{u'д', u"d"},
+        Mapping{u'е', u"e"}, Mapping{u'ж', u"zh"}, Mapping{u'з', u"z"}, Mapping{u'и', u"i"}, Mapping{u'й', u"j"},
+        Mapping{u'к', u"k"}, Mapping{u'л', u"l"}, Mapping{u'м', u"m"}, Mapping{u'н', u"n"}, Mapping{u'о', u"o"},
+        Mapping{u'п', u"p"}, Mapping{u'р', u"r"}, Mapping{u'с', u"s"}, Mapping{u'т', u"t"}, Mapping{u'у', u"u"},
+        Mapping{u'ф', u"f"}, Mapping{u'х', u"h"}, Mapping{u'ц', u"c"}, Mapping{u'ч', u"ch"}, Mapping{u'ш', u"sh"},
+        Mapping{u'щ', u"shh"}, Mapping{u'ы', u"y"}, Mapping{u'э', u"je"}, Mapping{u'ю', u"ju"}, Mapping{u'я', u"ja"}
+    >();
+}
+
+/**
+ ShiftAndMatch against the displaced MultiMatch over random text: longest matches one after
+ another and the same text typed a character at a time. Tables whose Shift-And state doesn't
+ fit in a machine word only have the displaced figures.
+ */
+BENCHMARK(shiftAnd) {
+    std::printf("%-16s %4s %6s %16s %16s %6s %16s %16s\n", "table", "bits",
+                "bytes", "displaced", "keystrokes", "bytes", "shift-and", "keystrokes");
+    forEachShippedTable([](const char * name, auto mapper) {
+        compareShiftAnd(name, mapper);
+    });
+    compareShiftAnd("ru lowercase", g_ruLowerMapper);
+    compareShiftAnd("20 singles", g_singlesMapper);
+}
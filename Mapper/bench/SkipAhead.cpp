@@ -0,0 +1,88 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/SkipAhead.hpp>
+
+#include <vector>
+
+namespace {
+
+    enum class Skip {
+        /** Try to match at every unmappable character, as Transliterator did before skipping ahead */
+        none,
+        /** Skip with the scalar loop of findKeyStart() */
+        scalar,
+        /** Skip with findKeyStart() */
+        vector
+    };
+
+    template<const auto & Matcher, Skip How>
+    auto skip(const char16_t * first, const char16_t * last) -> const char16_t * {
+        if constexpr (How == Skip::none)
+            return first;
+        else if constexpr (How == Skip::scalar)
+            return Impl::KeyStartScanner<Matcher>::scalar(first, last);
+        else
+            return findKeyStart<Matcher>(first, last);
+    }
+
+    /** Bulk transliteration that copies unmappable characters through as skip() finds them */
+    template<class Mapper, Skip How>
+    auto skippingLoop(std::u16string_view in, char16_t * out) -> size_t {
+        constexpr auto & matcher = Mapper::matcher;
+
+        auto start = out;
+        const auto end = in.data() + in.size();
+        auto unmapped = in.data();
+        for(auto current = skip<matcher, How>(unmapped, end); current != end; ) {
+            auto res = prefixMatch(matcher, std::ranges::subrange(current, end));
+            if (res.index != matcher.noMatch) {
+                out = std::copy(unmapped, current, out);
+                auto output = Mapper::mappings[res.index];
+                out = std::copy(output.begin(), output.end(), out);
+                current = res.next;
+                unmapped = current;
+            } else {
+                current = skip<matcher, How>(current + 1, end);
+            }
+        }
+        out = std::copy(unmapped, end, out);
+        return size_t(out - start);
+    }
+
+    /** Words of Cyrillic, which the ru table passes through, and of Latin in the given percentage */
+    auto mixedScript(std::mt19937 & rng, unsigned latinPercent, size_t length) -> std::u16string {
+        std::uniform_int_distribution<unsigned> percent(0, 99);
+        std::u16string ret;
+        ret.reserve(length + 16);
+        while(ret.size() < length) {
+            auto from = percent(rng) < latinPercent ? std::u16string_view(u"abcdefghijklmnopqrstuvwxyz")
+                                                    : std::u16string_view(u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя");
+            ret += randomWords(rng, from, 1);
+            if (percent(rng) < 20)
+                ret += randomText(rng, u",.;:!?-0123456789()", 3);
+        }
+        return ret;
+    }
+}
+
+/** Bulk transliteration with the ru table over text mixing Cyrillic, Latin, digits and punctuation */
+BENCHMARK(skipAhead) {
+    using Mapper = decltype(g_mapperRuDefault<TableRange>);
+
+    std::printf("%-16s %12s %12s %12s\n", "Latin words", "no skip", "scalar", "vector");
+    for(unsigned latin: {0, 10, 50, 90, 100}) {
+        std::mt19937 rng(1);
+        auto text = mixedScript(rng, latin, Bench::scaled(4'000'000));
+        std::vector<char16_t> buffer(text.size() * Mapper::maxExpansion);
+
+        const size_t bytes = text.size() * sizeof(char16_t);
+        auto none = Bench::measure(bytes, [&]() { Bench::keep(skippingLoop<Mapper, Skip::none>(text, buffer.data())); });
+        auto scalar = Bench::measure(bytes, [&]() { Bench::keep(skippingLoop<Mapper, Skip::scalar>(text, buffer.data())); });
+        auto vector = Bench::measure(bytes, [&]() { Bench::keep(skippingLoop<Mapper, Skip::vector>(text, buffer.data())); });
+        std::printf("%15u%% %7.0f MB/s %7.0f MB/s %7.0f MB/s\n", latin, 1000 / none, 1000 / scalar, 1000 / vector);
+    }
+}
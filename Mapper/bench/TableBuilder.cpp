@@ -0,0 +1,59 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+/** Time buildTable() takes for synthetic tables of growing size in each layout and the size of the displaced one */
+BENCHMARK(buildTable) {
+    std::printf("%-8s %14s %14s %14s %12s\n", "keys", "dense", "displaced", "partitioned", "size");
+    for(size_t count: {1'000, 10'000, 100'000}) {
+        auto mappings = dictionaryMappings(Bench::scaled(count));
+        auto options = [](MatchLayout layout) {
+            return MatchOptions{.layout = layout, .minimize = true};
+        };
+
+        size_t size = 0;
+        auto dense = Bench::measure(1'000'000, [&]() { Bench::keep(buildTable(mappings, options(MatchLayout::dense)).size()); });
+        auto displaced = Bench::measure(1'000'000, [&]() { Bench::keep(size = buildTable(mappings, options(MatchLayout::displaced)).size()); });
+        auto partitioned = Bench::measure(1'000'000, [&]() {
+            Bench::keep(buildTable(mappings, options(MatchLayout::displaced), BuildOptions{.partitioned = true}).size());
+        });
+        std::printf("%-8zu %11.2f ms %11.2f ms %11.2f ms %12zu\n", mappings.size(), dense, displaced, partitioned, size);
+    }
+}
+
+/**
+ Time buildTable() takes for a large synthetic table from 1 thread to the number of hardware
+ threads. Doubles the count each step and always includes the hardware count itself.
+ */
+BENCHMARK(buildTableScaling) {
+    auto mappings = dictionaryMappings(Bench::scaled(200'000));
+    const MatchOptions options{.layout = MatchLayout::displaced, .minimize = true};
+
+    std::vector<unsigned> counts;
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    for(unsigned threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    std::printf("%zu keys, displaced\n", mappings.size());
+    std::printf("%8s %14s %8s %14s %8s\n", "threads", "whole", "speedup", "partitioned", "speedup");
+    double singleWhole = 0, singlePartitioned = 0;
+    for(auto threads: counts) {
+        auto whole = Bench::measure(1'000'000, [&]() {
+            Bench::keep(buildTable(mappings, options, BuildOptions{.threads = threads}).size());
+        });
+        auto partitioned = Bench::measure(1'000'000, [&]() {
+            Bench::keep(buildTable(mappings, options, BuildOptions{.threads = threads, .partitioned = true}).size());
+        });
+        if (threads == 1) {
+            singleWhole = whole;
+            singlePartitioned = partitioned;
+        }
+        std::printf("%8u %11.2f ms %7.2fx %11.2f ms %7.2fx\n", threads,
+                    whole, singleWhole / whole, partitioned, singlePartitioned / partitioned);
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+
+#include <Mapper/TableCache.hpp>
+
+namespace {
+
+    template<class Mappings>
+    void measureCache(const char * name, TableCache & cache, const Mappings & mappings) {
+        auto hash = Bench::measure(1'000, [&]() { Bench::keep(tableSourceHash(mappings)); });
+        //a different source hash every time makes every load a miss that builds and stores the table
+        uint64_t missHash = tableSourceHash(mappings);
+        auto miss = Bench::measure(1'000, [&]() {
+            auto table = cache.load(++missHash, [&]() -> const Mappings & { return mappings; });
+            Bench::keep(table.fromCache());
+        });
+        cache.load(mappings);
+        auto hit = Bench::measure(1'000, [&]() {
+            auto table = cache.load(mappings);
+            Bench::keep(table.fromCache());
+        });
+        std::printf("%-16s %8zu %10.1f us %10.1f us %10.1f us\n", name, mappings.size(), hash, miss, hit);
+    }
+}
+
+/**
+ Latency of TableCache::load() when the table has to be built and stored (cold) and when it is
+ mapped from the cache (warm), together with hashing the mappings, which both include
+ */
+BENCHMARK(tableCache) {
+    auto directory = std::filesystem::temp_directory_path() / "mapper-bench-cache";
+    std::filesystem::remove_all(directory);
+    TableCache cache(directory);
+
+    std::printf("%-16s %8s %13s %13s %13s\n", "table", "keys", "hash", "cold", "warm");
+    measureCache("he", cache, mappingsOf(g_mapperHeDefault<TableRange>));
+    measureCache("ru", cache, mappingsOf(g_mapperRuDefault<TableRange>));
+    for(size_t count: {10'000, 100'000}) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "dictionary %zuk", count / 1000);
+        measureCache(name, cache, dictionaryMappings(Bench::scaled(count)));
+    }
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+#include "../test/Tables.h"
+#include "../test/Utf8.h"
+
+#include <Mapper/Utf8Mapper.hpp>
+
+/**
+ Throughput of transliterateUtf8() against decoding to UTF-16, transliterating and encoding back,
+ per byte of UTF-8 input
+ */
+BENCHMARK(utf8Throughput) {
+    std::printf("%-16s %12s %12s %12s\n", "table", "input", "direct", "via UTF-16");
+    forEachShippedTable([](const char * name, auto mapper) {
+        std::mt19937 rng(1);
+        auto text = utf16ToUtf8(randomWords(rng, alphabetOf(mapper.matcher, u""), Bench::scaled(4'000'000)));
+        std::string out;
+        out.reserve(text.size() * decltype(mapper)::maxExpansion * 2);
+
+        auto direct = Bench::measure(text.size(), [&]() {
+            out.clear();
+            transliterateUtf8(mapper, text, out);
+            Bench::keep(out.size());
+        });
+        std::u16string out16;
+        auto transcoded = Bench::measure(text.size(), [&]() {
+            out16.clear();
+            transliterate(mapper, utf8ToUtf16(text), out16);
+            out = utf16ToUtf8(out16);
+            Bench::keep(out.size());
+        });
+        std::printf("%-16s %9zu KB %7.0f MB/s %7.0f MB/s\n", name, text.size() / 1024, 1000 / direct, 1000 / transcoded);
+    });
+}
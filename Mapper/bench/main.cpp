@@ -0,0 +1,47 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Bench.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    Bench::Case * g_first = nullptr;
+    Bench::Case ** g_last = &g_first;
+    bool g_quick = false;
+}
+
+bool Bench::add(Case & benchCase) noexcept {
+    *g_last = &benchCase;
+    g_last = &benchCase.next;
+    return true;
+}
+
+bool Bench::quick() noexcept {
+    return g_quick;
+}
+
+/**
+ Usage: mapper-bench [--quick] [filter]
+
+ Runs the benchmarks whose names contain filter or all of them
+ */
+int main(int argc, char * argv[]) {
+    const char * filter = "";
+    for(int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0)
+            g_quick = true;
+        else
+            filter = argv[i];
+    }
+
+    for(auto benchCase = g_first; benchCase; benchCase = benchCase->next) {
+        if (!std::strstr(benchCase->name, filter))
+            continue;
+        std::printf("\n%s\n", benchCase->name);
+        std::fflush(stdout);
+        benchCase->func();
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_BULK_TRANSLITERATE_HPP_INCLUDED
+#define TRANSLIT_HEADER_BULK_TRANSLITERATE_HPP_INCLUDED
+
+#include "Mapper.hpp"
+#include "SkipAhead.hpp"
+
+#include <span>
+
+template<class Sink, class Char>
+concept OutputSink = requires(Sink & sink, Char c, const Char * p) {
+    sink.push_back(c);
+    sink.append(p, p);
+};
+
+/**
+ Output sink that writes into a caller supplied buffer
+
+ Never allocates. Output that doesn't fit is dropped and overflowed() becomes true.
+ Transliteration never produces more than Mapper::maxExpansion characters per one it
+ consumes so a buffer of that many times the input size is always sufficient.
+ */
+template<class Char>
+class BufferSink {
+public:
+    constexpr BufferSink(std::span<Char> buffer) noexcept:
+        m_buffer(buffer)
+    {}
+
+    constexpr void push_back(Char c) noexcept {
+        if (m_size == m_buffer.size()) {
+            m_overflowed = true;
+            return;
+        }
+        m_buffer[m_size++] = c;
+    }
+
+    constexpr void append(const Char * first, const Char * last) noexcept {
+        size_t count = size_t(last - first);
+        if (count > m_buffer.size() - m_size) {
+            count = m_buffer.size() - m_size;
+            m_overflowed = true;
+        }
+        std::copy(first, first + count, m_buffer.data() + m_size);
+        m_size += count;
+    }
+
+    constexpr auto size() const noexcept -> size_t
+        { return m_size; }
+    constexpr auto view() const noexcept -> std::basic_string_view<Char>
+        { return {m_buffer.data(), m_size}; }
+    constexpr auto overflowed() const noexcept -> bool
+        { return m_overflowed; }
+
+private:
+    std::span<Char> m_buffer;
+    size_t m_size = 0;
+    bool m_overflowed = false;
+};
+
+/**
+ Transliterates the whole input in one pass
+
+ Unlike Transliterator the end of input is final: a match that could have been
+ extended by more input is taken as is. Runs of unmapped characters are skipped
+ over with findKeyStart() and passed to the sink in one append call.
+ */
+template<class Mapper, OutputSink<typename Mapper::Char> Sink>
+requires(std::is_same_v<typename Mapper::Payload, std::basic_string_view<typename Mapper::Char>>)
+constexpr void transliterate([[maybe_unused]] const Mapper & mapper, std::basic_string_view<typename Mapper::Char> in, Sink && out) {
+
+    constexpr auto & matcher = Mapper::matcher;
+
+    const auto end = in.data() + in.size();
+    auto unmapped = in.data();
+    auto current = findKeyStart<matcher>(unmapped, end);
+    while(current != end) {
+        auto res = prefixMatch(matcher, std::ranges::subrange(current, end));
+        if (res.index != matcher.noMatch) {
+            out.append(unmapped, current);
+            //single character outputs are by far the most common
+            if (auto output = Mapper::mappings[res.index]; output.size() == 1)
+                out.push_back(output[0]);
+            else
+                out.append(output.data(), output.data() + output.size());
+            current = res.next;
+            unmapped = current;
+        } else {
+            current = findKeyStart<matcher>(current + 1, end);
+        }
+    }
+    out.append(unmapped, current);
+}
+
+/**
+ Transliterates as much of the input as more input cannot change
+
+ Stops before the first match, or possible match, that more input could extend and returns
+ the number of characters consumed. Passing the rest again followed by more input, and to
+ transliterate() once the input ends, gives the same result as transliterate() over all of it.
+ This lets a stream be transliterated in chunks without a Transliterator.
+ */
+template<class Mapper, OutputSink<typename Mapper::Char> Sink>
+requires(std::is_same_v<typename Mapper::Payload, std::basic_string_view<typename Mapper::Char>>)
+constexpr auto transliterateDefinite([[maybe_unused]] const Mapper & mapper, std::basic_string_view<typename Mapper::Char> in, Sink && out) -> size_t {
+
+    constexpr auto & matcher = Mapper::matcher;
+
+    const auto end = in.data() + in.size();
+    auto unmapped = in.data();
+    auto current = findKeyStart<matcher>(unmapped, end);
+    while(current != end) {
+        auto res = prefixMatch(matcher, std::ranges::subrange(current, end));
+        if (!res.definite)
+            break;
+        if (res.index != matcher.noMatch) {
+            out.append(unmapped, current);
+            auto output = Mapper::mappings[res.index];
+            out.append(output.data(), output.data() + output.size());
+            current = res.next;
+            unmapped = current;
+        } else {
+            current = findKeyStart<matcher>(current + 1, end);
+        }
+    }
+    out.append(unmapped, current);
+    return size_t(current - in.data());
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_DIRECT_MATCH_HPP_INCLUDED
+#define TRANSLIT_HEADER_DIRECT_MATCH_HPP_INCLUDED
+
+#include "MultiMatch.hpp"
+
+namespace Impl {
+
+    struct DirectSizes {
+        size_t inputs;
+        size_t noMatch;
+        size_t classPages;
+    };
+
+    template<class Char, size_t MaxSize>
+    constexpr auto directSizes(const Inventory<Char, MaxSize> & inventory, size_t noMatch) noexcept -> DirectSizes {
+        return {inventory.inputs.size(), noMatch, ClassMapGeometry<Char>::pageCount(inventory.inputs)};
+    }
+}
+
+/**
+ Matcher for strings that are all single characters
+
+ The class of each input is the payload id of its string so looking up the class is the whole
+ match. The only transitions are from the start state to the state of each payload id.
+ Results are the same as those of MultiMatch for the same strings.
+ */
+template<class Char, Impl::DirectSizes Sizes>
+struct DirectMatch {
+    static constexpr size_t noMatch = Sizes.noMatch;
+    static constexpr size_t maxKeyLength = 1;
+
+    using CharType = Char;
+    //payload ids, the start state and noState/noClass must all be distinct
+    using SizeType = Impl::UnsignedFor<Sizes.noMatch + 1>;
+    using ClassType = SizeType;
+    using OutcomeType = Impl::Outcome<size_t>;
+    using ClassGeometry = Impl::ClassMapGeometry<Char>;
+    using PageType = std::conditional_t<(Sizes.classPages <= std::numeric_limits<unsigned char>::max() + 1), unsigned char,
+                                                                                                              unsigned short>;
+
+    static constexpr SizeType noState = SizeType(-1);
+    static constexpr ClassType noClass = ClassType(-1);
+    /** Payload ids are the other states */
+    static constexpr SizeType startState = SizeType(Sizes.noMatch);
+
+    std::array<Char, Sizes.inputs> inputs;
+    /** Class of each of inputs outside of the class pages */
+    std::array<ClassType, (sizeof(Char) > 2 ? Sizes.inputs : 0)> inputClasses;
+    std::array<PageType, ClassGeometry::directorySize> classDirectory;
+    std::array<ClassType, Sizes.classPages * ClassGeometry::pageSize> classPages;
+
+    /** Returns the payload id of the string c or noClass if there is no such string */
+    constexpr auto inputClass(Char c) const noexcept -> ClassType
+        { return Impl::lookUpClass(*this, c); }
+
+    /** Returns the state reached from state on input class or noState */
+    constexpr auto next(SizeType state, size_t input) const noexcept -> SizeType
+        { return state == startState ? SizeType(input) : noState; }
+
+    /** Whether reaching state is a successful match */
+    constexpr bool accepts(SizeType state) const noexcept
+        { return state < startState; }
+
+    /** Outcome of an accepting state. Nothing can follow a single character */
+    constexpr auto outcome(SizeType state) const noexcept -> OutcomeType
+        { return OutcomeType(state, true); }
+};
+
+/**
+ Builds the matcher for the given single character strings.
+
+ A successful match reports PayloadIds.ids[i] for the i-th string, same as makeMultiMatch().
+ */
+template<Impl::PayloadIds PayloadIds, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest) &&
+         First.size() == 1 && ((Rest.size() == 1) && ...))
+consteval auto makeDirectMatch() {
+
+    using Char = CharTypeOf<First>;
+
+    constexpr auto inventory = Impl::makeInventory<First, Rest...>();
+    constexpr auto sizes = Impl::directSizes(inventory, 1 + sizeof...(Rest));
+    DirectMatch<Char, sizes> ret{};
+
+    using State = decltype(inventory)::State;
+
+    std::copy(inventory.inputs.begin(), inventory.inputs.end(), ret.inputs.begin());
+    std::array<size_t, sizes.inputs> classes;
+    for(size_t i = 0; i < sizes.inputs; ++i) {
+        //strings and characters don't necessarily sort the same way so look the state up
+        auto & state = *std::lower_bound(inventory.states.begin(), inventory.states.end(), State{.str = {&inventory.inputs[i], 1}});
+        classes[i] = PayloadIds.ids[state.payloadIdx];
+    }
+    Impl::fillClassMap(ret, classes);
+
+    return ret;
+}
+
+#endif
@@ -0,0 +1,462 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_FLAT_TABLE_HPP_INCLUDED
+#define TRANSLIT_HEADER_FLAT_TABLE_HPP_INCLUDED
+
+#include "Mapper.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string>
+
+/**
+ Header of a serialized mapping table
+
+ A table is a single block of bytes: this header followed by sections at offsets that are
+ fully determined by it (see Impl::FlatTableLayout). Every section holds fixed width values
+ in native byte order so it can be used in place, e.g. straight from a memory mapped file.
+
+ Sections in order:
+ - inputs: Char[inputs], sorted
+ - class directory: uint32_t[ClassMapGeometry<Char>::directorySize]
+ - class pages: uint32_t[classPages * ClassMapGeometry<Char>::pageSize]
+ - outcomes: uint32_t[outcomes] in Impl::Outcome<uint32_t> encoding
+ - for dense layout: target uint32_t[transitionSlots]
+ - for displaced layout: base uint32_t[states] followed by {owner, target} uint32_t[2 * transitionSlots]
+ - payload offsets: uint32_t[payloads]
+ - payload lengths: uint32_t[payloads]
+ - payload characters: Char[poolSize]
+
+ Each section starts at a multiple of 4. Missing transitions and classes are 0xFFFFFFFF.
+ The checksum is FNV-1a of everything except itself. It is the last field of the header.
+ */
+struct FlatTableHeader {
+    /** "TLTB" when read in native byte order. A file from a machine of different endianness won't match */
+    static constexpr uint32_t signature = 0x42544C54;
+    /** Incremented on any incompatible change to the format */
+    static constexpr uint32_t currentVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t charSize;
+    uint32_t layout;
+    uint32_t inputs;
+    uint32_t states;
+    uint32_t outcomes;
+    uint32_t payloads;
+    uint32_t classPages;
+    uint32_t transitionSlots;
+    uint32_t maxKeyLength;
+    uint32_t startState;
+    uint32_t poolSize;
+    uint32_t checksum;
+};
+
+namespace Impl {
+
+    template<class Char>
+    struct FlatTableLayout {
+        static constexpr uint64_t alignment = 4;
+
+        uint64_t inputs = 0;
+        uint64_t classDirectory = 0;
+        uint64_t classPages = 0;
+        uint64_t outcomes = 0;
+        uint64_t bases = 0;
+        uint64_t cells = 0;
+        uint64_t payloadOffsets = 0;
+        uint64_t payloadLengths = 0;
+        uint64_t pool = 0;
+        uint64_t size = 0;
+
+        //64 bit arithmetic so that no header values can overflow it
+        static constexpr auto make(const FlatTableHeader & header) noexcept -> FlatTableLayout {
+            using ClassGeometry = ClassMapGeometry<Char>;
+
+            FlatTableLayout ret;
+            uint64_t used = sizeof(FlatTableHeader);
+            auto place = [&](uint64_t count, uint64_t elementSize) {
+                auto start = (used + alignment - 1) / alignment * alignment;
+                used = start + count * elementSize;
+                return start;
+            };
+            ret.inputs = place(header.inputs, sizeof(Char));
+            ret.classDirectory = place(ClassGeometry::directorySize, sizeof(uint32_t));
+            ret.classPages = place(uint64_t(header.classPages) * ClassGeometry::pageSize, sizeof(uint32_t));
+            ret.outcomes = place(header.outcomes, sizeof(uint32_t));
+            if (header.layout == uint32_t(MatchLayout::displaced)) {
+                ret.bases = place(header.states, sizeof(uint32_t));
+                ret.cells = place(uint64_t(header.transitionSlots) * 2, sizeof(uint32_t));
+            } else {
+                ret.cells = place(header.transitionSlots, sizeof(uint32_t));
+            }
+            ret.payloadOffsets = place(header.payloads, sizeof(uint32_t));
+            ret.payloadLengths = place(header.payloads, sizeof(uint32_t));
+            ret.pool = place(header.poolSize, sizeof(Char));
+            ret.size = place(0, 1);
+            return ret;
+        }
+    };
+
+    inline auto flatTableChecksum(std::span<const std::byte> bytes) noexcept -> uint32_t {
+        uint32_t ret = 2166136261u;
+        auto add = [&](std::span<const std::byte> part) {
+            for(auto b: part) {
+                ret ^= uint32_t(b);
+                ret *= 16777619u;
+            }
+        };
+        add(bytes.first(offsetof(FlatTableHeader, checksum)));
+        add(bytes.subspan(sizeof(FlatTableHeader)));
+        return ret;
+    }
+
+    /** Typed view of count elements of a section. The caller has checked that they are in range */
+    template<class T>
+    auto flatSection(std::span<const std::byte> bytes, uint64_t offset, uint64_t count) noexcept -> std::span<const T> {
+        return {reinterpret_cast<const T *>(bytes.data() + offset), size_t(count)};
+    }
+
+    [[noreturn]] inline void invalidFlatTable(const char * what) {
+        throw std::runtime_error(std::string("invalid mapping table: ") + what);
+    }
+
+    template<class T>
+    void storeFlat(std::vector<std::byte> & bytes, uint64_t offset, size_t idx, T value) noexcept {
+        std::memcpy(bytes.data() + offset + idx * sizeof(T), &value, sizeof(T));
+    }
+}
+
+/**
+ Runtime matcher over a serialized table
+
+ Does not own the table bytes which must outlive it. Can be used with prefixMatch, resumeMatch
+ and match exactly like the MultiMatch it was serialized from and gives the same results.
+
+ The constructor validates the whole table, including that every index in it is in range,
+ and throws std::runtime_error if it is malformed. The bytes must be 4-byte aligned, which
+ memory mapped files and heap allocations always are.
+ */
+template<class Char>
+class FlatMatch {
+public:
+    using CharType = Char;
+    using SizeType = uint32_t;
+    using ClassType = uint32_t;
+    using OutcomeType = Impl::Outcome<uint32_t>;
+    using ClassGeometry = Impl::ClassMapGeometry<Char>;
+
+    static constexpr SizeType noState = SizeType(-1);
+    static constexpr ClassType noClass = ClassType(-1);
+
+    /** Index reported when nothing matched, also the number of payloads */
+    size_t noMatch;
+    /** Length of the longest string matched. A pending match is always shorter */
+    size_t maxKeyLength;
+
+    std::span<const Char> inputs;
+    std::span<const OutcomeType> outcomes;
+    SizeType startState;
+
+public:
+    explicit FlatMatch(std::span<const std::byte> bytes);
+
+    /** Returns the index of c in inputs or noClass if not present */
+    auto inputClass(Char c) const noexcept -> ClassType {
+        auto uc = typename ClassGeometry::UChar(c);
+        if constexpr (sizeof(Char) > 2) {
+            if (uc >= ClassGeometry::directLimit) {
+                auto it = std::lower_bound(inputs.begin(), inputs.end(), c);
+                if (it == inputs.end() || *it != c)
+                    return noClass;
+                return ClassType(it - inputs.begin());
+            }
+        }
+        auto page = size_t(m_classDirectory[uc >> ClassGeometry::pageBits]);
+        return m_classPages[(page << ClassGeometry::pageBits) | (uc & (ClassGeometry::pageSize - 1))];
+    }
+
+    /** Returns the state reached from state on input class or noState */
+    auto next(SizeType state, size_t input) const noexcept -> SizeType {
+        if (m_displaced) {
+            auto cell = 2 * (size_t(m_bases[state]) + input);
+            return m_cells[cell] == state ? m_cells[cell + 1] : noState;
+        }
+        return m_cells[state * inputs.size() + input];
+    }
+
+    /** Whether reaching state is a successful match */
+    auto accepts(SizeType state) const noexcept -> bool
+        { return state < outcomes.size(); }
+
+    /** Outcome of an accepting state */
+    auto outcome(SizeType state) const noexcept -> OutcomeType
+        { return outcomes[state]; }
+
+private:
+    std::span<const uint32_t> m_classDirectory;
+    std::span<const uint32_t> m_classPages;
+    std::span<const uint32_t> m_bases;
+    std::span<const uint32_t> m_cells;
+    bool m_displaced;
+};
+
+template<class Char>
+FlatMatch<Char>::FlatMatch(std::span<const std::byte> bytes) {
+
+    if (bytes.size() < sizeof(FlatTableHeader))
+        Impl::invalidFlatTable("too short");
+    if (reinterpret_cast<uintptr_t>(bytes.data()) % Impl::FlatTableLayout<Char>::alignment != 0)
+        Impl::invalidFlatTable("misaligned");
+
+    FlatTableHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != FlatTableHeader::signature)
+        Impl::invalidFlatTable("bad signature or byte order");
+    if (header.version != FlatTableHeader::currentVersion)
+        Impl::invalidFlatTable("unsupported version");
+    if (header.charSize != sizeof(Char))
+        Impl::invalidFlatTable("wrong character size");
+    if (header.layout != uint32_t(MatchLayout::dense) && header.layout != uint32_t(MatchLayout::displaced))
+        Impl::invalidFlatTable("unknown layout");
+    auto layout = Impl::FlatTableLayout<Char>::make(header);
+    if (layout.size != bytes.size())
+        Impl::invalidFlatTable("size mismatch");
+    if (Impl::flatTableChecksum(bytes) != header.checksum)
+        Impl::invalidFlatTable("checksum mismatch");
+
+    //values with the top bit set are reserved for noState/noClass and Outcome's final flag
+    constexpr uint32_t limit = uint32_t(1) << 31;
+    if (header.outcomes == 0 || header.outcomes > header.states || header.states >= limit ||
+        header.inputs >= limit || header.payloads >= limit || header.startState >= header.states)
+        Impl::invalidFlatTable("inconsistent sizes");
+
+    m_displaced = (header.layout == uint32_t(MatchLayout::displaced));
+    noMatch = header.payloads;
+    maxKeyLength = header.maxKeyLength;
+    startState = header.startState;
+    inputs = Impl::flatSection<Char>(bytes, layout.inputs, header.inputs);
+    outcomes = Impl::flatSection<OutcomeType>(bytes, layout.outcomes, header.outcomes);
+    m_classDirectory = Impl::flatSection<uint32_t>(bytes, layout.classDirectory, ClassGeometry::directorySize);
+    m_classPages = Impl::flatSection<uint32_t>(bytes, layout.classPages, uint64_t(header.classPages) * ClassGeometry::pageSize);
+    m_cells = Impl::flatSection<uint32_t>(bytes, layout.cells, (m_displaced ? 2 : 1) * uint64_t(header.transitionSlots));
+    if (m_displaced)
+        m_bases = Impl::flatSection<uint32_t>(bytes, layout.bases, header.states);
+
+    //everything below guarantees that lookups never leave the table whatever the input
+    if (!std::is_sorted(inputs.begin(), inputs.end()))
+        Impl::invalidFlatTable("inputs are not sorted");
+    for(auto page: m_classDirectory) {
+        if (page >= header.classPages)
+            Impl::invalidFlatTable("class page out of range");
+    }
+    for(auto cls: m_classPages) {
+        if (cls != noClass && cls >= header.inputs)
+            Impl::invalidFlatTable("input class out of range");
+    }
+    for(auto outcome: outcomes) {
+        if (outcome.value() >= header.payloads)
+            Impl::invalidFlatTable("payload index out of range");
+    }
+    if (m_displaced) {
+        for(auto base: m_bases) {
+            if (uint64_t(base) + header.inputs > header.transitionSlots)
+                Impl::invalidFlatTable("transition base out of range");
+        }
+        for(size_t i = 0; i < m_cells.size(); i += 2) {
+            if ((m_cells[i] == noState) != (m_cells[i + 1] == noState) ||
+                (m_cells[i] != noState && (m_cells[i] >= header.states || m_cells[i + 1] >= header.states)))
+                Impl::invalidFlatTable("transition out of range");
+        }
+    } else {
+        if (uint64_t(header.states) * header.inputs != header.transitionSlots)
+            Impl::invalidFlatTable("inconsistent sizes");
+        for(auto target: m_cells) {
+            if (target != noState && target >= header.states)
+                Impl::invalidFlatTable("transition out of range");
+        }
+    }
+}
+
+/**
+ Runtime longest prefix mapper over a serialized table
+
+ Same interface and results as the PrefixMapper the table was serialized from (see serializeTable)
+ except that the table is only known at runtime. Payloads are views into the table bytes which must
+ outlive the mapper. Cheap to copy.
+ */
+template<class Char>
+class FlatMapper {
+public:
+    using Payload = std::basic_string_view<Char>;
+
+    template<std::ranges::forward_range Range>
+    using Result = PrefixMappingResult<Payload, std::ranges::iterator_t<const Range>>;
+
+public:
+    /** Validates the table and throws std::runtime_error if it is malformed */
+    explicit FlatMapper(std::span<const std::byte> bytes);
+
+    auto matcher() const noexcept -> const FlatMatch<Char> &
+        { return m_matcher; }
+    auto maxExpansion() const noexcept -> size_t
+        { return m_maxExpansion; }
+
+    template<std::ranges::forward_range Range>
+    requires(std::is_same_v<typename std::ranges::range_value_t<Range>, Char>)
+    auto operator()(const Range & range) const -> Result<Range>
+        { return makeResult<Range>(prefixMatch(m_matcher, range)); }
+
+    template<std::ranges::forward_range Range>
+    requires(std::is_same_v<typename std::ranges::range_value_t<Range>, Char>)
+    auto operator()(MatchCursor & cursor, const Range & range) const -> Result<Range>
+        { return makeResult<Range>(resumeMatch(m_matcher, cursor, range)); }
+
+private:
+    template<class Range>
+    auto makeResult(const PrefixMatchResult<std::ranges::iterator_t<const Range>> & res) const -> Result<Range> {
+        if (res.index != m_matcher.noMatch)
+            return Result<Range>{res.next, Payload(m_pool.data() + m_offsets[res.index], m_lengths[res.index]), res.definite};
+        return Result<Range>{res.next, std::nullopt, res.definite};
+    }
+
+private:
+    FlatMatch<Char> m_matcher;
+    std::span<const uint32_t> m_offsets;
+    std::span<const uint32_t> m_lengths;
+    std::span<const Char> m_pool;
+    size_t m_maxExpansion = 1;
+};
+
+template<class Char>
+FlatMapper<Char>::FlatMapper(std::span<const std::byte> bytes):
+    m_matcher(bytes) {
+
+    FlatTableHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    auto layout = Impl::FlatTableLayout<Char>::make(header);
+
+    m_offsets = Impl::flatSection<uint32_t>(bytes, layout.payloadOffsets, header.payloads);
+    m_lengths = Impl::flatSection<uint32_t>(bytes, layout.payloadLengths, header.payloads);
+    m_pool = Impl::flatSection<Char>(bytes, layout.pool, header.poolSize);
+    for(size_t i = 0; i < header.payloads; ++i) {
+        if (uint64_t(m_offsets[i]) + m_lengths[i] > header.poolSize)
+            Impl::invalidFlatTable("payload out of range");
+        //every key is at least one character long so the longest payload is an upper bound
+        m_maxExpansion = std::max(m_maxExpansion, size_t(m_lengths[i]));
+    }
+}
+
+namespace Impl {
+
+    inline void checkFlatTableLimits(size_t states, size_t payloads, size_t transitionSlots, size_t poolSize) {
+        //values with the top bit set are reserved
+        constexpr size_t limit = size_t(1) << 31;
+        if (states >= limit || payloads >= limit || transitionSlots >= limit || poolSize >= limit)
+            throw std::length_error("mapping table is too large to serialize");
+    }
+
+    template<class Char, Sizes Sizes, MatchLayout Layout>
+    auto makeFlatTableHeader(const MultiMatch<Char, Sizes, Layout> & matcher, size_t poolSize) -> FlatTableHeader {
+        checkFlatTableLimits(Sizes.states, Sizes.noMatch, Sizes.transitionSlots, poolSize);
+
+        FlatTableHeader ret{};
+        ret.magic = FlatTableHeader::signature;
+        ret.version = FlatTableHeader::currentVersion;
+        ret.charSize = sizeof(Char);
+        ret.layout = uint32_t(Layout);
+        ret.inputs = uint32_t(Sizes.inputs);
+        ret.states = uint32_t(Sizes.states);
+        ret.outcomes = uint32_t(Sizes.outcomes);
+        ret.payloads = uint32_t(Sizes.noMatch);
+        ret.classPages = uint32_t(Sizes.classPages);
+        ret.transitionSlots = uint32_t(Sizes.transitionSlots);
+        ret.maxKeyLength = uint32_t(Sizes.maxKeyLength);
+        ret.startState = uint32_t(matcher.startState);
+        ret.poolSize = uint32_t(poolSize);
+        return ret;
+    }
+
+    template<class Char, Sizes Sizes, MatchLayout Layout>
+    void storeFlatMatch(const MultiMatch<Char, Sizes, Layout> & matcher, const FlatTableLayout<Char> & layout,
+                        std::vector<std::byte> & bytes) {
+        auto state = [&](auto val) {
+            return val == matcher.noState ? FlatMatch<Char>::noState : uint32_t(val);
+        };
+
+        for(size_t i = 0; i < matcher.inputs.size(); ++i)
+            storeFlat(bytes, layout.inputs, i, matcher.inputs[i]);
+        for(size_t i = 0; i < matcher.classDirectory.size(); ++i)
+            storeFlat(bytes, layout.classDirectory, i, uint32_t(matcher.classDirectory[i]));
+        for(size_t i = 0; i < matcher.classPages.size(); ++i) {
+            auto cls = matcher.classPages[i];
+            storeFlat(bytes, layout.classPages, i, cls == matcher.noClass ? FlatMatch<Char>::noClass : uint32_t(cls));
+        }
+        for(size_t i = 0; i < matcher.outcomes.size(); ++i)
+            storeFlat(bytes, layout.outcomes, i, Outcome<uint32_t>(uint32_t(matcher.outcomes[i].value()), matcher.outcomes[i].final()));
+        if constexpr (Layout == MatchLayout::displaced) {
+            for(size_t i = 0; i < matcher.transitions.bases.size(); ++i)
+                storeFlat(bytes, layout.bases, i, uint32_t(matcher.transitions.bases[i]));
+            for(size_t i = 0; i < matcher.transitions.cells.size(); ++i) {
+                storeFlat(bytes, layout.cells, 2 * i, state(matcher.transitions.cells[i].owner));
+                storeFlat(bytes, layout.cells, 2 * i + 1, state(matcher.transitions.cells[i].target));
+            }
+        } else {
+            for(size_t i = 0; i < matcher.transitions.cells.size(); ++i)
+                storeFlat(bytes, layout.cells, i, state(matcher.transitions.cells[i]));
+        }
+    }
+
+    /** Stores payloads[i] for i in [0, count) one after another in the pool */
+    template<class Char, class Payloads>
+    void storeFlatPayloads(const Payloads & payloads, size_t count, const FlatTableLayout<Char> & layout,
+                           std::vector<std::byte> & bytes) {
+        size_t used = 0;
+        for(size_t i = 0; i < count; ++i) {
+            std::basic_string_view<Char> payload = payloads[i];
+            storeFlat(bytes, layout.payloadOffsets, i, uint32_t(used));
+            storeFlat(bytes, layout.payloadLengths, i, uint32_t(payload.size()));
+            for(auto c: payload)
+                storeFlat(bytes, layout.pool, used++, c);
+        }
+    }
+
+    /** Stores the header with the checksum of everything else already in bytes */
+    inline void sealFlatTable(FlatTableHeader header, std::vector<std::byte> & bytes) noexcept {
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        header.checksum = flatTableChecksum(bytes);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+    }
+}
+
+/**
+ Serializes a text PrefixMapper into the format read by FlatMapper
+
+ The result can be written to a file and later loaded, possibly memory mapped, to get a mapper
+ that behaves exactly like this one without it being compiled in.
+ */
+template<class Mapper>
+requires(std::is_same_v<typename Mapper::Payload, std::basic_string_view<typename Mapper::Char>>)
+auto serializeTable(const Mapper & /*mapper*/) -> std::vector<std::byte> {
+    using Char = typename Mapper::Char;
+    static constexpr auto matcher = Mapper::makeTableMatcher();
+    constexpr size_t payloadCount = matcher.noMatch;
+
+    size_t poolSize = 0;
+    for(size_t i = 0; i < payloadCount; ++i)
+        poolSize += Mapper::mappings[i].size();
+
+    auto header = Impl::makeFlatTableHeader(matcher, poolSize);
+    auto layout = Impl::FlatTableLayout<Char>::make(header);
+    std::vector<std::byte> ret(size_t(layout.size));
+
+    Impl::storeFlatMatch(matcher, layout, ret);
+    Impl::storeFlatPayloads(Mapper::mappings, payloadCount, layout, ret);
+    Impl::sealFlatTable(header, ret);
+    return ret;
+}
+
+#endif
@@ -0,0 +1,217 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_INLINE_TRANSLITERATOR_HPP_INCLUDED
+#define TRANSLIT_HEADER_INLINE_TRANSLITERATOR_HPP_INCLUDED
+
+#include "Mapper.hpp"
+#include "SkipAhead.hpp"
+
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+namespace Impl {
+
+    /**
+     Fixed capacity queue of characters that can always be viewed as a contiguous string
+
+     Every character is stored twice, capacity apart, so the contents never wrap around
+     even though the head moves. Dropping characters from either end is O(1).
+     */
+    template<class Char, size_t MinCapacity>
+    requires(MinCapacity > 0)
+    class MirroredRing {
+    public:
+        static constexpr size_t capacity = std::bit_ceil(MinCapacity);
+
+        constexpr auto size() const noexcept -> size_t
+            { return m_size; }
+        constexpr auto data() const noexcept -> const Char *
+            { return m_data + m_head; }
+        constexpr auto view() const noexcept -> std::basic_string_view<Char>
+            { return {data(), m_size}; }
+
+        constexpr void push_back(Char c) noexcept {
+            assert(m_size < capacity);
+            auto pos = (m_head + m_size) & mask;
+            m_data[pos] = c;
+            m_data[pos + capacity] = c;
+            ++m_size;
+        }
+
+        constexpr void append(const Char * first, const Char * last) noexcept {
+            for ( ; first != last; ++first)
+                push_back(*first);
+        }
+
+        constexpr void dropFront(size_t count) noexcept {
+            assert(count <= m_size);
+            m_head = (m_head + count) & mask;
+            m_size -= count;
+        }
+
+        constexpr void truncate(size_t size) noexcept {
+            assert(size <= m_size);
+            m_size = size;
+        }
+
+        constexpr void clear() noexcept {
+            m_head = 0;
+            m_size = 0;
+        }
+    private:
+        static constexpr size_t mask = capacity - 1;
+
+        Char m_data[2 * capacity] = {};
+        size_t m_head = 0;
+        size_t m_size = 0;
+    };
+}
+
+/**
+ Transliterator that never allocates
+
+ Same behavior as Transliterator but bound to a single mapper type and backed by fixed
+ inline buffers. The pending prefix is always shorter than the longest key of the mapper
+ so its buffer is sized from it. The result buffer holds OutputCapacity characters:
+ append() throws std::length_error without changing anything if the result might not fit.
+ Calling clearCompleted() after every append, as an input processor does, keeps the
+ result no longer than Mapper::maxExpansion times the pending prefix plus one append's
+ worth of input. Like Transliterator it rescans the pending prefix unless Matching says otherwise.
+ */
+template<class Mapper, size_t OutputCapacity = 64, PrefixMatching Matching = PrefixMatching::rescan>
+requires(std::is_same_v<typename Mapper::Payload, std::basic_string_view<typename Mapper::Char>>)
+class InlineTransliterator {
+public:
+    using Char = typename Mapper::Char;
+    using StringView = std::basic_string_view<Char>;
+
+    static constexpr size_t prefixCapacity = Mapper::matcher.maxKeyLength;
+    static constexpr size_t outputCapacity = OutputCapacity;
+public:
+    constexpr InlineTransliterator() noexcept = default;
+    constexpr InlineTransliterator(const Mapper &) noexcept
+    {}
+
+    constexpr void append(StringView str) {
+        //every pending or new input character produces at most maxExpansion output ones
+        if (m_translitCompletedSize + (m_prefix.size() + str.size()) * Mapper::maxExpansion > outputCapacity)
+            throw std::length_error("transliteration result exceeds inline capacity");
+        //the prefix left pending by process() is always shorter than its capacity
+        //so each round makes progress
+        while (!str.empty()) {
+            auto count = std::min(str.size(), m_prefix.capacity - m_prefix.size());
+            m_prefix.append(str.data(), str.data() + count);
+            process();
+            str.remove_prefix(count);
+        }
+    }
+
+    /**
+     Treats the end of input as definite completing everything pending.
+     Afterwards result() is entirely completed.
+     */
+    constexpr void finish() noexcept {
+        m_translit.truncate(m_translitCompletedSize);
+
+        const auto begin = m_prefix.data();
+        const auto end = begin + m_prefix.size();
+        for (auto start = begin; start != end; ) {
+            auto res = match(start, end);
+            //there is no more input so whatever we have is final
+            if (res.index != Mapper::matcher.noMatch) {
+                m_matchedSomething = true;
+                auto output = Mapper::mappings[res.index];
+                m_translit.append(output.data(), output.data() + output.size());
+                start = res.next;
+            } else {
+                m_translit.push_back(*start);
+                ++start;
+            }
+            m_translitCompletedSize = m_translit.size();
+            m_cursor = {};
+        }
+        m_prefix.clear();
+    }
+
+    constexpr auto result() const noexcept -> StringView
+        { return m_translit.view(); }
+    constexpr auto completedSize() const noexcept -> size_t
+        { return m_translitCompletedSize; }
+    constexpr auto matchedSomething() const noexcept -> bool
+        { return m_matchedSomething; }
+
+    constexpr void clear() noexcept {
+        m_prefix.clear();
+        m_cursor = {};
+        m_translit.clear();
+        m_translitCompletedSize = 0;
+        m_matchedSomething = false;
+    }
+
+    constexpr void clearCompleted() noexcept {
+        m_translit.dropFront(m_translitCompletedSize);
+        m_translitCompletedSize = 0;
+        if (m_translit.size() == 0)
+            m_matchedSomething = false;
+    }
+
+private:
+    constexpr auto match(const Char * start, const Char * end) noexcept {
+        if constexpr (Matching == PrefixMatching::resume)
+            return resumeMatch(Mapper::matcher, m_cursor, std::ranges::subrange(start, end));
+        else
+            return prefixMatch(Mapper::matcher, std::ranges::subrange(start, end));
+    }
+
+    constexpr void process() noexcept {
+        m_translit.truncate(m_translitCompletedSize);
+
+        const auto begin = m_prefix.data();
+        const auto end = begin + m_prefix.size();
+        auto completed = begin;
+        for (auto start = begin; start != end; ) {
+            //when resuming the cursor always starts at start: either fresh or left from
+            //the previous round where start was the beginning of the pending prefix
+            auto res = match(start, end);
+            if (res.index != Mapper::matcher.noMatch) {
+                m_matchedSomething = true;
+                auto output = Mapper::mappings[res.index];
+                m_translit.append(output.data(), output.data() + output.size());
+                //if the result is not definite we don't know if a longer match is possible so bail out
+                if (!res.definite)
+                    break;
+                //otherwise mark it as completed and continue
+                start = res.next;
+                m_translitCompletedSize = m_translit.size();
+                completed = start;
+            } else if (!res.definite) {
+                //no match but could be with more input, bail out
+                m_matchedSomething = true;
+                m_translit.append(start, end);
+                break;
+            } else {
+                //no match and couldn't be
+                //consume 1 untranslated char together with all the following ones
+                //that cannot start a match and continue
+                auto next = findKeyStart<Mapper::matcher>(start + 1, end);
+                m_translit.append(start, next);
+                start = next;
+                m_translitCompletedSize = m_translit.size();
+                completed = start;
+            }
+            m_cursor = {};
+        }
+        m_prefix.dropFront(size_t(completed - begin));
+    }
+
+private:
+    Impl::MirroredRing<Char, prefixCapacity> m_prefix;
+    MatchCursor m_cursor;
+    Impl::MirroredRing<Char, OutputCapacity> m_translit;
+    size_t m_translitCompletedSize = 0;
+    bool m_matchedSomething = false;
+};
+
+#endif
@@ -0,0 +1,440 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_LAZY_TABLE_HPP_INCLUDED
+#define TRANSLIT_HEADER_LAZY_TABLE_HPP_INCLUDED
+
+#include "Mapper.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct LazyTableOptions {
+    /** Maximum number of states whose transition rows are cached at once. 0 disables the cache */
+    size_t maxCachedStates = 4096;
+};
+
+struct LazyTableStats {
+    /** Transitions taken from a cached row */
+    size_t hits = 0;
+    /** Transitions from states whose rows were not cached */
+    size_t misses = 0;
+    /** Rows dropped to make room for others */
+    size_t evictions = 0;
+    /** States whose rows are cached now */
+    size_t residentStates = 0;
+    /** Largest residentStates since construction or resetStats() */
+    size_t peakResidentStates = 0;
+    /** Misses whose row could not be cached for lack of memory */
+    size_t failedAllocations = 0;
+};
+
+template<class Char>
+class LazyTable;
+
+/**
+ Matcher over a LazyTable
+
+ Works with prefixMatch(), resumeMatch() and match() like MultiMatch does. Cheap to copy. All copies
+ share the table and its cache.
+ */
+template<class Char>
+class LazyMatch {
+public:
+    using CharType = Char;
+    using SizeType = size_t;
+    using ClassType = uint32_t;
+    using OutcomeType = Impl::Outcome<uint32_t>;
+
+    static constexpr SizeType noState = SizeType(-1);
+    static constexpr ClassType noClass = ClassType(-1);
+
+    /** Index reported when nothing matched, also the number of payloads */
+    size_t noMatch;
+    /** Length of the longest string matched. A pending match is always shorter */
+    size_t maxKeyLength;
+
+    std::span<const Char> inputs;
+    std::span<const OutcomeType> outcomes;
+    SizeType startState;
+
+public:
+    explicit LazyMatch(const LazyTable<Char> & table) noexcept;
+
+    /** Returns the index of c in inputs or noClass if not present */
+    auto inputClass(Char c) const noexcept -> ClassType {
+        auto it = std::lower_bound(inputs.begin(), inputs.end(), c);
+        if (it == inputs.end() || *it != c)
+            return noClass;
+        return ClassType(it - inputs.begin());
+    }
+
+    /** Returns the state reached from state on input class or noState */
+    auto next(SizeType state, size_t input) const noexcept -> SizeType
+        { return m_table->next(state, input); }
+
+    /** Whether reaching state is a successful match */
+    auto accepts(SizeType state) const noexcept -> bool
+        { return state < outcomes.size(); }
+
+    /** Outcome of an accepting state */
+    auto outcome(SizeType state) const noexcept -> OutcomeType
+        { return outcomes[state]; }
+
+private:
+    const LazyTable<Char> * m_table;
+};
+
+/**
+ Mapping table whose automaton states are only built when matching first reaches them
+
+ Holds just the sorted distinct keys and the payloads. A state is a prefix of the keys and is
+ identified by the first key that has it and its length so, unlike in MultiMatch, states need no
+ numbering pass. Accepting states, ones equal to a whole key, are the indices of the keys and so
+ are still below outcomes.size(). The transition row of a state is computed by binary search over
+ the keys the first time the state is left and is then kept in a cache of at most
+ LazyTableOptions::maxCachedStates rows. When it is full the rows not used recently are dropped.
+ Memory, beyond the keys themselves, thus grows with the number of distinct states actually
+ visited rather than with the size of the table.
+
+ Results are identical to those of buildTable() for the same mappings. The cache is updated by
+ const operations so a table must not be used by more than one thread at a time. Not copyable or
+ movable since matchers and mappers refer to it.
+ */
+template<class Char>
+class LazyTable {
+    friend class LazyMatch<Char>;
+public:
+    using Payload = std::basic_string_view<Char>;
+    using SizeType = typename LazyMatch<Char>::SizeType;
+    using OutcomeType = typename LazyMatch<Char>::OutcomeType;
+
+    static constexpr SizeType noState = LazyMatch<Char>::noState;
+
+public:
+    /**
+     mappings is a sequence of (dst, src) pairs like for buildTable(). Throws std::invalid_argument
+     if it is empty or contains an empty src and std::length_error if the table is too large.
+     */
+    template<std::ranges::forward_range Mappings>
+    explicit LazyTable(const Mappings & mappings, LazyTableOptions options = {});
+
+    LazyTable(const LazyTable &) = delete;
+    LazyTable & operator=(const LazyTable &) = delete;
+
+    auto payload(size_t idx) const noexcept -> Payload
+        { return Payload(m_payloadChars.data() + m_payloadStarts[idx], m_payloadStarts[idx + 1] - m_payloadStarts[idx]); }
+    auto maxExpansion() const noexcept -> size_t
+        { return m_maxExpansion; }
+
+    auto stats() const noexcept -> LazyTableStats {
+        auto ret = m_stats;
+        ret.residentStates = m_slots.size();
+        return ret;
+    }
+    /** Zeroes the counters. The cache is kept and the peak starts from its current size */
+    void resetStats() noexcept {
+        m_stats = LazyTableStats{};
+        m_stats.peakResidentStates = m_slots.size();
+    }
+
+private:
+    auto key(size_t idx) const noexcept -> std::basic_string_view<Char>
+        { return {m_keyChars.data() + m_keyStarts[idx], m_keyStarts[idx + 1] - m_keyStarts[idx]}; }
+
+    auto keyCount() const noexcept -> size_t
+        { return m_outcomes.size(); }
+
+    /** State of the prefix of the given length of key idx, which must be the first key with this prefix */
+    auto stateOf(size_t idx, size_t length) const noexcept -> SizeType {
+        if (key(idx).size() == length)
+            return idx;
+        return keyCount() + idx * m_maxKeyLength + length;
+    }
+
+    struct Prefix {
+        size_t first;
+        size_t last;
+        size_t length;
+    };
+
+    /** The keys [first, last) that start with the prefix of the state */
+    auto prefixOf(SizeType state) const noexcept -> Prefix {
+        Prefix ret;
+        if (state < keyCount()) {
+            ret.first = state;
+            ret.length = key(state).size();
+        } else {
+            ret.first = (state - keyCount()) / m_maxKeyLength;
+            ret.length = (state - keyCount()) % m_maxKeyLength;
+        }
+        auto prefix = key(ret.first).substr(0, ret.length);
+        size_t lo = ret.first + 1, hi = keyCount();
+        while(lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (key(mid).starts_with(prefix))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        ret.last = lo;
+        return ret;
+    }
+
+    /**
+     First key in [first, last) whose character at pos is not less than c or, if upper is true,
+     greater than c. All of them must be longer than pos.
+     */
+    auto boundAt(size_t first, size_t last, size_t pos, Char c, bool upper) const noexcept -> size_t {
+        using Traits = std::char_traits<Char>;
+        while(first < last) {
+            auto mid = first + (last - first) / 2;
+            auto keyChar = key(mid)[pos];
+            if (upper ? !Traits::lt(c, keyChar) : Traits::lt(keyChar, c))
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return first;
+    }
+
+    auto next(SizeType state, size_t input) const noexcept -> SizeType;
+    auto transition(SizeType state, Char c) const noexcept -> SizeType;
+    auto materialize(SizeType state) const -> size_t;
+
+private:
+    std::vector<Char> m_keyChars;
+    std::vector<uint32_t> m_keyStarts;
+    std::vector<Char> m_payloadChars;
+    std::vector<uint32_t> m_payloadStarts;
+    std::vector<Char> m_inputs;
+    std::vector<OutcomeType> m_outcomes;
+    size_t m_payloadCount = 0;
+    size_t m_maxKeyLength = 0;
+    size_t m_maxExpansion = 1;
+    size_t m_maxCachedStates = 0;
+
+    //cache: rows of inputs.size() states each, the state in each slot and its CLOCK reference bit
+    mutable std::unordered_map<SizeType, size_t> m_slots;
+    mutable std::vector<SizeType> m_rows;
+    mutable std::vector<SizeType> m_slotStates;
+    mutable std::vector<uint8_t> m_referenced;
+    mutable size_t m_clockHand = 0;
+    mutable LazyTableStats m_stats;
+};
+
+template<std::ranges::forward_range Mappings>
+LazyTable(const Mappings &, LazyTableOptions = {}) -> LazyTable<typename std::ranges::range_value_t<Mappings>::first_type::value_type>;
+
+template<class Char>
+template<std::ranges::forward_range Mappings>
+LazyTable<Char>::LazyTable(const Mappings & mappings, LazyTableOptions options):
+    m_maxCachedStates(options.maxCachedStates) {
+
+    using String = std::basic_string_view<Char>;
+
+    std::vector<String> dsts, srcs;
+    m_payloadStarts.push_back(0);
+    for(auto & [dst, src]: mappings) {
+        String dstView(dst);
+        dsts.push_back(dstView);
+        srcs.push_back(String(src));
+        if (srcs.back().empty())
+            throw std::invalid_argument("mapping source cannot be empty");
+        m_payloadChars.insert(m_payloadChars.end(), dstView.begin(), dstView.end());
+        if (m_payloadChars.size() > std::numeric_limits<uint32_t>::max())
+            throw std::length_error("mapping table is too large");
+        m_payloadStarts.push_back(uint32_t(m_payloadChars.size()));
+        m_maxExpansion = std::max(m_maxExpansion, dstView.size());
+        m_maxKeyLength = std::max(m_maxKeyLength, srcs.back().size());
+    }
+    if (srcs.empty())
+        throw std::invalid_argument("no mappings");
+    m_payloadCount = srcs.size();
+    //outcome values with the top bit set are reserved
+    if (m_payloadCount >= (size_t(1) << 31))
+        throw std::length_error("mapping table is too large");
+
+    //if a src is repeated the last occurrence wins
+    std::vector<size_t> order(srcs.size());
+    for(size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return srcs[lhs] < srcs[rhs];
+    });
+    std::vector<size_t> winners;
+    for(size_t i = 0; i < order.size(); ++i) {
+        if (i + 1 < order.size() && srcs[order[i + 1]] == srcs[order[i]])
+            continue;
+        winners.push_back(order[i]);
+    }
+
+    m_keyStarts.push_back(0);
+    for(auto idx: winners) {
+        m_keyChars.insert(m_keyChars.end(), srcs[idx].begin(), srcs[idx].end());
+        m_inputs.insert(m_inputs.end(), srcs[idx].begin(), srcs[idx].end());
+        if (m_keyChars.size() > std::numeric_limits<uint32_t>::max())
+            throw std::length_error("mapping table is too large");
+        m_keyStarts.push_back(uint32_t(m_keyChars.size()));
+    }
+    std::sort(m_inputs.begin(), m_inputs.end());
+    m_inputs.erase(std::unique(m_inputs.begin(), m_inputs.end()), m_inputs.end());
+    m_inputs.shrink_to_fit();
+
+    //report the same ids as buildTable()
+    std::vector<size_t> payloadIds(srcs.size());
+    for(size_t i = 0; i < payloadIds.size(); ++i)
+        payloadIds[i] = i;
+    Impl::mergePayloadIds(payloadIds, dsts);
+
+    m_outcomes.reserve(winners.size());
+    for(size_t i = 0; i < winners.size(); ++i) {
+        //in sorted order all the longer keys starting with this one immediately follow it
+        bool final = (i + 1 == winners.size() || !srcs[winners[i + 1]].starts_with(srcs[winners[i]]));
+        m_outcomes.push_back(OutcomeType(uint32_t(payloadIds[winners[i]]), final));
+    }
+}
+
+template<class Char>
+auto LazyTable<Char>::next(SizeType state, size_t input) const noexcept -> SizeType {
+    if (m_maxCachedStates != 0) {
+        if (auto it = m_slots.find(state); it != m_slots.end()) {
+            ++m_stats.hits;
+            m_referenced[it->second] = 1;
+            return m_rows[it->second * m_inputs.size() + input];
+        }
+        ++m_stats.misses;
+        try {
+            return m_rows[materialize(state) * m_inputs.size() + input];
+        } catch(std::bad_alloc &) {
+            //the cache is only an optimization: without memory for a row the transition is
+            //computed directly as with no cache and caching is tried again on the next miss
+            ++m_stats.failedAllocations;
+        }
+    } else {
+        ++m_stats.misses;
+    }
+    return transition(state, m_inputs[input]);
+}
+
+template<class Char>
+auto LazyTable<Char>::transition(SizeType state, Char c) const noexcept -> SizeType {
+    auto prefix = prefixOf(state);
+    //only the key equal to the prefix, if any, is not longer than it and it sorts first
+    auto first = prefix.first + (key(prefix.first).size() == prefix.length);
+    auto found = boundAt(first, prefix.last, prefix.length, c, false);
+    if (found == prefix.last || key(found)[prefix.length] != c)
+        return noState;
+    return stateOf(found, prefix.length + 1);
+}
+
+template<class Char>
+auto LazyTable<Char>::materialize(SizeType state) const -> size_t {
+    const size_t rowSize = m_inputs.size();
+
+    //every step that can throw leaves the cache consistent: all the memory a new slot needs is
+    //reserved before it is added and the map entry is added last, after which nothing throws
+    size_t slot;
+    if (m_slotStates.size() < m_maxCachedStates) {
+        slot = m_slotStates.size();
+        m_rows.resize((slot + 1) * rowSize);
+        m_referenced.reserve(slot + 1);
+        m_slotStates.reserve(slot + 1);
+        m_referenced.push_back(0);
+        m_slotStates.push_back(noState);
+    } else {
+        while(m_referenced[m_clockHand]) {
+            m_referenced[m_clockHand] = 0;
+            m_clockHand = (m_clockHand + 1) % m_slotStates.size();
+        }
+        slot = m_clockHand;
+        m_clockHand = (m_clockHand + 1) % m_slotStates.size();
+        if (m_slotStates[slot] != noState) {
+            m_slots.erase(m_slotStates[slot]);
+            m_slotStates[slot] = noState;
+            ++m_stats.evictions;
+        }
+    }
+    m_slots.emplace(state, slot);
+    m_slotStates[slot] = state;
+    m_referenced[slot] = 1;
+    m_stats.peakResidentStates = std::max(m_stats.peakResidentStates, m_slots.size());
+
+    auto row = m_rows.begin() + slot * rowSize;
+    std::fill(row, row + rowSize, noState);
+    auto prefix = prefixOf(state);
+    for(auto first = prefix.first + (key(prefix.first).size() == prefix.length); first != prefix.last; ) {
+        auto c = key(first)[prefix.length];
+        auto input = std::lower_bound(m_inputs.begin(), m_inputs.end(), c) - m_inputs.begin();
+        row[input] = stateOf(first, prefix.length + 1);
+        first = boundAt(first, prefix.last, prefix.length, c, true);
+    }
+    return slot;
+}
+
+template<class Char>
+LazyMatch<Char>::LazyMatch(const LazyTable<Char> & table) noexcept:
+    noMatch(table.m_payloadCount),
+    maxKeyLength(table.m_maxKeyLength),
+    inputs(table.m_inputs),
+    outcomes(table.m_outcomes),
+    //the empty prefix is never a key
+    startState(table.stateOf(0, 0)),
+    m_table(&table)
+{}
+
+/**
+ Runtime longest prefix mapper over a LazyTable
+
+ Same interface and results as FlatMapper. The table must outlive the mapper. Cheap to copy.
+ */
+template<class Char>
+class LazyMapper {
+public:
+    using Payload = std::basic_string_view<Char>;
+
+    template<std::ranges::forward_range Range>
+    using Result = PrefixMappingResult<Payload, std::ranges::iterator_t<const Range>>;
+
+public:
+    explicit LazyMapper(const LazyTable<Char> & table) noexcept:
+        m_table(&table),
+        m_matcher(table)
+    {}
+
+    auto matcher() const noexcept -> const LazyMatch<Char> &
+        { return m_matcher; }
+    auto maxExpansion() const noexcept -> size_t
+        { return m_table->maxExpansion(); }
+
+    template<std::ranges::forward_range Range>
+    requires(std::is_same_v<typename std::ranges::range_value_t<Range>, Char>)
+    auto operator()(const Range & range) const -> Result<Range>
+        { return makeResult<Range>(prefixMatch(m_matcher, range)); }
+
+    template<std::ranges::forward_range Range>
+    requires(std::is_same_v<typename std::ranges::range_value_t<Range>, Char>)
+    auto operator()(MatchCursor & cursor, const Range & range) const -> Result<Range>
+        { return makeResult<Range>(resumeMatch(m_matcher, cursor, range)); }
+
+private:
+    template<class Range>
+    auto makeResult(const PrefixMatchResult<std::ranges::iterator_t<const Range>> & res) const -> Result<Range> {
+        if (res.index != m_matcher.noMatch)
+            return Result<Range>{res.next, m_table->payload(res.index), res.definite};
+        return Result<Range>{res.next, std::nullopt, res.definite};
+    }
+
+private:
+    const LazyTable<Char> * m_table;
+    LazyMatch<Char> m_matcher;
+};
+
+#endif
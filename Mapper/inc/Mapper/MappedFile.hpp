@@ -0,0 +1,37 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_MAPPED_FILE_HPP_INCLUDED
+#define TRANSLIT_HEADER_MAPPED_FILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+/**
+ Read-only memory mapping of a whole file.
+ Pages are shared with every other process mapping the same file.
+ */
+class MappedFile {
+public:
+    /** Throws std::system_error if the file cannot be opened or mapped */
+    explicit MappedFile(const std::filesystem::path & path);
+    ~MappedFile();
+
+    MappedFile(MappedFile && src) noexcept:
+        m_data(std::exchange(src.m_data, nullptr)),
+        m_size(std::exchange(src.m_size, 0))
+    {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    auto bytes() const noexcept -> std::span<const std::byte>
+        { return {static_cast<const std::byte *>(m_data), m_size}; }
+
+private:
+    void * m_data = nullptr;
+    size_t m_size = 0;
+};
+
+#endif
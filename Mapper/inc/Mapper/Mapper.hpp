@@ -4,7 +4,7 @@
 #ifndef TRANSLIT_HEADER_MAPPER_HPP_INCLUDED
 #define TRANSLIT_HEADER_MAPPER_HPP_INCLUDED
 
-#include "MultiMatch.hpp"
+#include "MatchPolicy.hpp"
 
 template<class T, class Char, size_t N>
 struct Mapping {
@@ -15,11 +15,22 @@ struct Mapping {
         dst(c),
         src(arr)
     {}
+    constexpr Mapping(T c, const CTString<Char, N> & str) noexcept:
+        dst(c),
+        src(str)
+    {}
 };
 
 template<class T, class Char, size_t N>
 Mapping(T c, const Char (&arr)[N]) -> Mapping<T, Char, N - 1>;
 
+template<class T, class Char, size_t N>
+Mapping(T c, const CTString<Char, N> & str) -> Mapping<T, Char, N>;
+
+/** Mapping to a sequence of characters, e.g. Mapping{u"\u05E9\u05C1", u"sh"} */
+template<class Char, size_t M, size_t N>
+Mapping(const Char (&dst)[M], const Char (&arr)[N]) -> Mapping<CTString<Char, M - 1>, Char, N - 1>;
+
 template<class T>
 struct Value {
     const T value;
@@ -30,6 +41,182 @@ struct Value {
 };
 
 
+namespace Impl {
+
+    /** Whether mapping destination type T is text: a single Char or a CTString of them */
+    template<class T, class Char>
+    constexpr bool isOutputOf = std::is_same_v<T, Char>;
+    template<class Char, size_t N>
+    constexpr bool isOutputOf<CTString<Char, N>, Char> = true;
+
+    template<class Char>
+    constexpr auto outputView(const Char & c) -> std::basic_string_view<Char>
+        { return {&c, 1}; }
+    template<class Char, size_t N>
+    constexpr auto outputView(const CTString<Char, N> & str) -> std::basic_string_view<Char>
+        { return {str.begin(), N}; }
+
+    /**
+     Outputs of all the mappings packed into a single array of characters
+
+     Each mapping's output is described by an offset and length in it. An output that
+     is equal to or a prefix of another one shares its storage.
+     */
+    template<class Char, size_t Count, size_t Size, size_t MaxLength>
+    struct OutputPool {
+        using OffsetType = UnsignedFor<Size>;
+        using LengthType = UnsignedFor<MaxLength>;
+
+        std::array<Char, Size> chars;
+        std::array<OffsetType, Count> offsets;
+        std::array<LengthType, Count> lengths;
+
+        constexpr auto operator[](size_t idx) const noexcept -> std::basic_string_view<Char>
+            { return {chars.data() + offsets[idx], lengths[idx]}; }
+    };
+
+    /**
+     Outputs of mappings that all produce a single character
+
+     Stored directly in mapping order which is both smaller and faster to look up than
+     an OutputPool.
+     */
+    template<class Char, size_t Count>
+    struct SingleCharOutputs {
+        std::array<Char, Count> chars;
+
+        constexpr auto operator[](size_t idx) const noexcept -> std::basic_string_view<Char>
+            { return {chars.data() + idx, 1}; }
+    };
+
+    /**
+     Calls store(idx, output) for every output that needs its own storage and
+     share(idx, from, output) for the ones that can reuse the storage of output from
+     */
+    template<Mapping First, Mapping... Rest, class Store, class Share>
+    consteval void layOutOutputs(Store store, Share share) {
+        constexpr size_t N = 1 + sizeof...(Rest);
+        constexpr std::basic_string_view<CharTypeOf<First.src>> outputs[] = {outputView(First.dst), outputView(Rest.dst)...};
+
+        std::array<size_t, N> order;
+        for(size_t i = 0; i < N; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+            return outputs[lhs] < outputs[rhs];
+        });
+        //in sorted order a string is immediately followed by the longer ones it is a prefix of
+        for(size_t i = N; i-- > 0; ) {
+            if (i + 1 < N && outputs[order[i + 1]].starts_with(outputs[order[i]]))
+                share(order[i], order[i + 1], outputs[order[i]]);
+            else
+                store(order[i], outputs[order[i]]);
+        }
+    }
+
+    template<Mapping First, Mapping... Rest>
+    consteval auto makeOutputPool() {
+        using Char = CharTypeOf<First.src>;
+        constexpr size_t count = 1 + sizeof...(Rest);
+        constexpr size_t size = []() consteval {
+            size_t ret = 0;
+            layOutOutputs<First, Rest...>([&](size_t, auto output) { ret += output.size(); }, [](size_t, size_t, auto) {});
+            return ret;
+        }();
+        constexpr size_t maxLength = std::max({outputView(First.dst).size(), outputView(Rest.dst).size()...});
+
+        using Pool = OutputPool<Char, count, size, maxLength>;
+        Pool ret{};
+        size_t used = 0;
+        layOutOutputs<First, Rest...>([&](size_t idx, auto output) {
+            std::copy(output.begin(), output.end(), ret.chars.begin() + used);
+            ret.offsets[idx] = typename Pool::OffsetType(used);
+            ret.lengths[idx] = typename Pool::LengthType(output.size());
+            used += output.size();
+        }, [&](size_t idx, size_t from, auto output) {
+            ret.offsets[idx] = ret.offsets[from];
+            ret.lengths[idx] = typename Pool::LengthType(output.size());
+        });
+        return ret;
+    }
+
+    /**
+     Whether every output is a single character
+     
+     A loop over an array rather than a && fold: g++ evaluates folds over thousands of
+     mappings in quadratic time and memory.
+     */
+    template<Mapping First, Mapping... Rest>
+    consteval bool allSingleChars() {
+        constexpr size_t lengths[] = {outputView(First.dst).size(), outputView(Rest.dst).size()...};
+        return std::ranges::all_of(lengths, [](size_t length) { return length == 1; });
+    }
+
+    /**
+     Payload of every mapping by index
+
+     Text is packed into SingleCharOutputs or an OutputPool so payloads of any length are
+     views into it. Other payload types are stored as is.
+     */
+    template<Mapping First, Mapping... Rest>
+    consteval auto makeMappingPayloads() {
+        using Char = CharTypeOf<First.src>;
+        if constexpr (isOutputOf<std::remove_const_t<decltype(First.dst)>, Char> &&
+                      (isOutputOf<std::remove_const_t<decltype(Rest.dst)>, Char> && ...)) {
+            if constexpr (allSingleChars<First, Rest...>())
+                return SingleCharOutputs<Char, 1 + sizeof...(Rest)>{{outputView(First.dst)[0], outputView(Rest.dst)[0]...}};
+            else
+                return makeOutputPool<First, Rest...>();
+        } else {
+            return std::array{First.dst, Rest.dst...};
+        }
+    }
+
+    /** All destinations are of the same type or all are text, possibly of different lengths */
+    template<Mapping First, Mapping... Rest>
+    constexpr bool SameDestinationKind =
+        (std::is_same_v<decltype(First.dst), decltype(Rest.dst)> && ...) ||
+        (isOutputOf<std::remove_const_t<decltype(First.dst)>, CharTypeOf<First.src>> &&
+         (isOutputOf<std::remove_const_t<decltype(Rest.dst)>, CharTypeOf<First.src>> && ...));
+
+    /**
+     Gives strings mapped to equal payloads the same id so their states can be merged
+
+     ids must be the identity on entry. Each string ends up with the smallest index among the
+     ones with equal payloads.
+     */
+    template<class Ids, class Payloads>
+    constexpr void mergePayloadIds(Ids & ids, const Payloads & payloads) {
+        using T = std::remove_cvref_t<decltype(payloads[0])>;
+        const size_t count = ids.size();
+        if constexpr (std::totally_ordered<T>) {
+            std::vector<size_t> order(ids.begin(), ids.end());
+            std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+                return payloads[lhs] < payloads[rhs] || (payloads[lhs] == payloads[rhs] && lhs < rhs);
+            });
+            for(size_t i = 1; i < count; ++i) {
+                if (payloads[order[i]] == payloads[order[i - 1]])
+                    ids[order[i]] = ids[order[i - 1]];
+            }
+        } else if constexpr (std::equality_comparable<T>) {
+            for(size_t i = 1; i < count; ++i) {
+                for(size_t j = 0; j < i; ++j) {
+                    if (payloads[j] == payloads[i]) {
+                        ids[i] = ids[j];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    template<size_t N, class Payloads>
+    consteval auto makePayloadIds(const Payloads & payloads) -> PayloadIds<N> {
+        auto ret = PayloadIds<N>::identity();
+        mergePayloadIds(ret.ids, payloads);
+        return ret;
+    }
+}
+
 template<class Payload, class It>
 struct PrefixMappingResult {
     /**
@@ -48,28 +235,126 @@ constexpr auto nullPrefixMapper(const Range & range) {
     return PrefixMappingResult<Payload, std::ranges::iterator_t<const Range>>{std::ranges::begin(range), std::nullopt, true};
 }
 
+template<class Payload, std::ranges::forward_range Range>
+constexpr auto nullPrefixMapper(MatchCursor & /*cursor*/, const Range & range) {
+    return nullPrefixMapper<Payload>(range);
+}
+
+/** How a transliterator matches its pending prefix on every append */
+enum class PrefixMatching {
+    /** Match the whole pending prefix again. Keys are short so this is cheap and it is the default */
+    rescan,
+    /** Keep a MatchCursor and feed only the newly appended characters. Pays off only for long keys */
+    resume
+};
+
+/**
+ Longest prefix mapper over a fixed set of mappings
+ 
+ Can be called directly, with or without a MatchCursor, or converted to
+ a plain function pointer of either form.
+ */
+template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+class PrefixMapper {
+public:
+    static constexpr auto mappings = Impl::makeMappingPayloads<First, Rest...>();
+
+    using Payload = std::remove_cvref_t<decltype(mappings[0])>;
+    using Char = CharTypeOf<First.src>;
+    using Iterator = std::ranges::iterator_t<const Range>;
+    using Result = PrefixMappingResult<Payload, Iterator>;
+
+    using MappingFunc = Result (const Range &);
+    using ResumableMappingFunc = Result (MatchCursor &, const Range &);
+
+    static constexpr MatchOptions options = Options;
+
+    /** Mapper of the same mappings built with other options, e.g. to compare layouts */
+    template<MatchOptions OtherOptions>
+    using WithOptions = PrefixMapper<Range, OtherOptions, First, Rest...>;
+
+    /** Id matcher reports for each of mappings. Mappings with equal payloads share one */
+    static constexpr auto payloadIds = Impl::makePayloadIds<1 + sizeof...(Rest)>(mappings);
+
+    /** The engine of matcher, its size and what it was chosen by */
+    static constexpr MatchPlan matchPlan = makeMatchPlan<Options, payloadIds, First.src, Rest.src...>();
+
+    /** The matcher makeMatcher() builds for the mappings. Its kind depends on Options and matchPlan */
+    static constexpr auto matcher = makeMatcher<Options, payloadIds, First.src, Rest.src...>();
+
+    /**
+     MultiMatch with the same results as matcher and a column per input, as the serialized
+     format has. This is what serializeTable() stores
+     */
+    static consteval auto makeTableMatcher() {
+        constexpr MatchOptions tableOptions = []() {
+            auto ret = Options;
+            ret.mergeInputs = false;
+            return ret;
+        }();
+        return makeMultiMatch<tableOptions, payloadIds, First.src, Rest.src...>();
+    }
+
+    /** Upper bound on output characters produced per input character consumed */
+    static constexpr size_t maxExpansion = []() {
+        if constexpr (std::is_same_v<Payload, std::basic_string_view<Char>>) {
+            constexpr size_t lengths[] = {First.src.size(), Rest.src.size()...};
+            size_t ret = 1;
+            for(size_t i = 0; i < std::size(lengths); ++i)
+                ret = std::max(ret, (mappings[i].size() + lengths[i] - 1) / lengths[i]);
+            return ret;
+        } else {
+            return size_t(1);
+        }
+    }();
+    
+public:
+    static constexpr auto map(const Range & range) -> Result {
+        return makeResult(prefixMatch(matcher, range));
+    }
+
+    static constexpr auto resume(MatchCursor & cursor, const Range & range) -> Result {
+        return makeResult(resumeMatch(matcher, cursor, range));
+    }
+
+    constexpr auto operator()(const Range & range) const -> Result
+        { return map(range); }
+    constexpr auto operator()(MatchCursor & cursor, const Range & range) const -> Result
+        { return resume(cursor, range); }
+
+    constexpr operator MappingFunc *() const noexcept
+        { return map; }
+    constexpr operator ResumableMappingFunc *() const noexcept
+        { return resume; }
+
+private:
+    static constexpr auto makeResult(const PrefixMatchResult<Iterator> & res) -> Result {
+        if (res.index != matcher.noMatch)
+            return Result{res.next, mappings[res.index], res.definite};
+        return Result{res.next, std::nullopt, res.definite};
+    }
+};
+
+template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+requires(SameCharType<First.src, Rest.src...> &&
+         Impl::SameDestinationKind<First, Rest...> &&
+         std::is_same_v<typename std::ranges::range_value_t<Range>, CharTypeOf<First.src>>)
+constexpr auto makePrefixMapper() {
+    return PrefixMapper<Range, Options, First, Rest...>{};
+}
+
+/**
+ Mapper with the default options: minimized and with the engine makeMatchPlan() picks for the
+ mappings. Small tables get a ShiftAndMatch or DirectMatch where the cost model says so and the
+ rest a displaced MultiMatch. Serialized tables are always the displaced MultiMatch.
+ */
 template<std::ranges::forward_range Range, Mapping First, Mapping... Rest>
 requires(SameCharType<First.src, Rest.src...> &&
-         (std::is_same_v<decltype(First.dst), decltype(Rest.dst)> && ...) &&
+         Impl::SameDestinationKind<First, Rest...> &&
          std::is_same_v<typename std::ranges::range_value_t<Range>, CharTypeOf<First.src>>)
 constexpr auto makePrefixMapper() {
-    
-    using Payload = std::remove_const_t<decltype(First.dst)>;
-    using Char = CharTypeOf<First.src>;
-    
-    auto func = [](const Range & range) {
-        using Iterator = std::ranges::iterator_t<const Range>;
-        
-        static constexpr auto multiMatch = makeMultiMatch<First.src, Rest.src...>();
-        static constexpr Payload mappings[1 + sizeof...(Rest)] = {First.dst, Rest.dst...};
-        
-        auto res = prefixMatch(multiMatch, range);
-        if (res.index != multiMatch.noMatch)
-            return PrefixMappingResult<Payload, Iterator>{res.next, mappings[res.index], res.definite};
-        return PrefixMappingResult<Payload, Iterator>{res.next, std::nullopt, res.definite};
-    };
-    
-    return func;
+    return makePrefixMapper<Range, MatchOptions{.layout = MatchLayout::displaced, .minimize = true, .selectEngine = true},
+                            First, Rest...>();
 }
 
 template<std::ranges::forward_range Range, Value Default, Mapping First, Mapping... Rest>
@@ -80,11 +365,8 @@ requires(SameCharType<First.src, Rest.src...> &&
 constexpr auto makeMapper() {
     
     using Payload = std::remove_const_t<decltype(First.dst)>;
-    using Char = CharTypeOf<First.src>;
     
     auto func = [](const Range & range) {
-        using Iterator = std::ranges::iterator_t<const Range>;
-        
         static constexpr auto multiMatch = makeMultiMatch<First.src, Rest.src...>();
         static constexpr Payload mappings[2 + sizeof...(Rest)] = {First.dst, Rest.dst..., Default.value};
         
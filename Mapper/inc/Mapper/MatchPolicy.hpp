@@ -0,0 +1,214 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_MATCH_POLICY_HPP_INCLUDED
+#define TRANSLIT_HEADER_MATCH_POLICY_HPP_INCLUDED
+
+#include "MultiMatch.hpp"
+#include "ShiftAndMatch.hpp"
+#include "DirectMatch.hpp"
+
+/** Matchers makeMatcher() can build */
+enum class MatchEngine {
+    /** MultiMatch with MatchLayout::dense */
+    dense,
+    /** MultiMatch with MatchLayout::displaced */
+    displaced,
+    /** ShiftAndMatch. Only if its state fits in a machine word */
+    bitParallel,
+    /** DirectMatch. Only if all the strings are single characters */
+    direct
+};
+
+inline constexpr size_t matchEngineCount = 4;
+
+constexpr auto matchEngineName(MatchEngine engine) noexcept -> std::string_view {
+    switch(engine) {
+        case MatchEngine::dense:        return "dense";
+        case MatchEngine::displaced:    return "displaced";
+        case MatchEngine::bitParallel:  return "bit-parallel";
+        case MatchEngine::direct:       return "direct";
+    }
+    return {};
+}
+
+/** Shape of a set of strings the choice of engine is based on */
+struct MatchStats {
+    /** Number of distinct characters */
+    size_t inputs;
+    /** Number of input classes. Fewer than inputs with MatchOptions::mergeInputs */
+    size_t classes;
+    /** Number of automaton states. Fewer with MatchOptions::minimize */
+    size_t states;
+    size_t minKeyLength;
+    size_t maxKeyLength;
+    /** Largest number of transitions out of a single state */
+    size_t maxFanOut;
+    /** Bits in the state of a ShiftAndMatch */
+    size_t shiftAndBits;
+};
+
+struct MatchEngineCost {
+    /** Whether the engine can match the strings at all */
+    bool available = false;
+    /** Size of its matcher */
+    size_t bytes = 0;
+    /** Estimated time per input character. Only meaningful compared to other engines */
+    double cost = 0;
+};
+
+/**
+ The engine makeMatcher() builds for a set of strings and the estimates it was picked by
+
+ Candidates are indexed by MatchEngine.
+ */
+struct MatchPlan {
+    MatchStats stats;
+    std::array<MatchEngineCost, matchEngineCount> candidates;
+    MatchEngine engine;
+    /** Size of the matcher makeMatcher() builds */
+    size_t bytes;
+
+    constexpr auto operator[](MatchEngine candidate) const noexcept -> const MatchEngineCost &
+        { return candidates[size_t(candidate)]; }
+};
+
+namespace Impl {
+
+    /**
+     Cost model behind MatchOptions::selectEngine
+
+     Steps are the time per character of matching with the matcher in L1, roughly in ns on a 3 GHz
+     core, as measured by transliterating random sequences of keys. Mispredicted branches at the key
+     boundaries take most of it, so a dense row (one load), a displaced cell (two dependent loads)
+     and Shift-And (a longer arithmetic chain and a bit scan for the outcome) end up closer than
+     their instructions suggest. A DirectMatch does no transitions at all. The part of a matcher
+     beyond cacheBudget is taken to miss L1 in proportion to its size, at missCost per miss.
+     The steps can be checked against the costModel benchmark and cacheBudget and missCost
+     against the cacheBudget one: matching slows down by 1-2 ns up to about 64 KiB and by 2-6 ns
+     from there to a few MB.
+     */
+    struct MatchCostModel {
+        static constexpr double directStep = 10.5;
+        static constexpr double denseStep = 11;
+        static constexpr double displacedStep = 11.2;
+        static constexpr double bitParallelStep = 11.5;
+        /** Share of L1 a matcher can count on next to the application whose text it transliterates */
+        static constexpr size_t cacheBudget = 16384;
+        static constexpr double missCost = 4;
+        /** Costs closer than this fraction to the cheapest are within measurement noise and count as equal */
+        static constexpr double noise = 0.05;
+
+        static constexpr auto cost(double step, size_t bytes) noexcept -> double {
+            if (bytes <= cacheBudget)
+                return step;
+            return step + missCost * double(bytes - cacheBudget) / double(bytes);
+        }
+    };
+
+    constexpr auto withLayout(MatchOptions options, MatchLayout layout) noexcept -> MatchOptions {
+        options.layout = layout;
+        return options;
+    }
+}
+
+/**
+ Estimates the cost of every engine for the given strings and picks one.
+
+ With Options.selectEngine the smallest of the available engines whose cost is within
+ MatchCostModel::noise of the cheapest one wins. Otherwise it is the MultiMatch with Options.layout. Everything is known at compile time so
+ the result can be inspected, e.g. PrefixMapper::matchPlan.
+ */
+template<MatchOptions Options, Impl::PayloadIds PayloadIds, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest))
+consteval auto makeMatchPlan() -> MatchPlan {
+
+    using Char = CharTypeOf<First>;
+    using Model = Impl::MatchCostModel;
+
+    //displacing rows is the only part that depends on the layout and dense sizes follow from the rest
+    constexpr auto multi = Impl::planMultiMatch<Impl::withLayout(Options, MatchLayout::displaced), PayloadIds, First, Rest...>();
+    constexpr Impl::Sizes displacedSizes = multi.sizes;
+    constexpr Impl::Sizes denseSizes{displacedSizes.inputs, displacedSizes.classes, displacedSizes.states, displacedSizes.outcomes,
+                                     displacedSizes.noMatch, displacedSizes.classPages, displacedSizes.classes * displacedSizes.states,
+                                     displacedSizes.maxKeyLength};
+    constexpr size_t minKeyLength = std::min({First.size(), Rest.size()...});
+    constexpr auto shiftAndSizes = Impl::shiftAndSizes(multi.inventory, displacedSizes.noMatch, displacedSizes.maxKeyLength);
+    constexpr auto directSizes = Impl::directSizes(multi.inventory, displacedSizes.noMatch);
+
+    MatchPlan ret{};
+
+    std::vector<size_t> fanOuts(displacedSizes.states);
+    for(auto & edge: multi.automaton.edges)
+        ++fanOuts[edge.from];
+    ret.stats = {displacedSizes.inputs, displacedSizes.classes, displacedSizes.states, minKeyLength, displacedSizes.maxKeyLength,
+                 *std::max_element(fanOuts.begin(), fanOuts.end()), shiftAndSizes.bits};
+
+    auto consider = [&](MatchEngine engine, size_t bytes, double step) {
+        ret.candidates[size_t(engine)] = {true, bytes, Model::cost(step, bytes)};
+    };
+    consider(MatchEngine::dense,
+             sizeof(MultiMatch<Char, denseSizes, MatchLayout::dense>),
+             Model::denseStep);
+    consider(MatchEngine::displaced,
+             sizeof(MultiMatch<Char, displacedSizes, MatchLayout::displaced>),
+             Model::displacedStep);
+    if constexpr (shiftAndSizes.bits <= Impl::maxShiftAndBits)
+        consider(MatchEngine::bitParallel, sizeof(ShiftAndMatch<Char, shiftAndSizes>), Model::bitParallelStep);
+    if constexpr (minKeyLength == 1 && displacedSizes.maxKeyLength == 1)
+        consider(MatchEngine::direct, sizeof(DirectMatch<Char, directSizes>), Model::directStep);
+
+    if constexpr (Options.selectEngine) {
+        double cheapest = ret[MatchEngine::displaced].cost;
+        for(auto & candidate: ret.candidates) {
+            if (candidate.available)
+                cheapest = std::min(cheapest, candidate.cost);
+        }
+        ret.engine = MatchEngine::displaced;
+        for(size_t i = 0; i < matchEngineCount; ++i) {
+            auto & candidate = ret.candidates[i];
+            if (!candidate.available || candidate.cost > cheapest * (1 + Model::noise))
+                continue;
+            auto & best = ret[ret.engine];
+            if (best.cost > cheapest * (1 + Model::noise) || candidate.bytes < best.bytes)
+                ret.engine = MatchEngine(i);
+        }
+    } else {
+        ret.engine = (Options.layout == MatchLayout::dense ? MatchEngine::dense : MatchEngine::displaced);
+    }
+    ret.bytes = ret[ret.engine].bytes;
+    return ret;
+}
+
+template<MatchOptions Options, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...>)
+consteval auto makeMatchPlan() -> MatchPlan {
+    return makeMatchPlan<Options, Impl::PayloadIds<1 + sizeof...(Rest)>::identity(), First, Rest...>();
+}
+
+/**
+ Builds the matcher makeMatchPlan() picks for the given strings.
+
+ This is a MultiMatch unless Options.selectEngine is set. All the matchers report the same results.
+ */
+template<MatchOptions Options, Impl::PayloadIds PayloadIds, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest))
+consteval auto makeMatcher() {
+    constexpr auto plan = makeMatchPlan<Options, PayloadIds, First, Rest...>();
+    if constexpr (plan.engine == MatchEngine::direct)
+        return makeDirectMatch<PayloadIds, First, Rest...>();
+    else if constexpr (plan.engine == MatchEngine::bitParallel)
+        return makeShiftAndMatch<PayloadIds, First, Rest...>();
+    else if constexpr (plan.engine == MatchEngine::dense)
+        return makeMultiMatch<Impl::withLayout(Options, MatchLayout::dense), PayloadIds, First, Rest...>();
+    else
+        return makeMultiMatch<Impl::withLayout(Options, MatchLayout::displaced), PayloadIds, First, Rest...>();
+}
+
+template<MatchOptions Options, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...>)
+consteval auto makeMatcher() {
+    return makeMatcher<Options, Impl::PayloadIds<1 + sizeof...(Rest)>::identity(), First, Rest...>();
+}
+
+#endif
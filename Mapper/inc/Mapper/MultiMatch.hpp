@@ -12,7 +12,9 @@
 #include <vector>
 #include <string_view>
 #include <climits>
+#include <limits>
 #include <stdexcept>
+#include <span>
 
 template<class Char, size_t N>
 struct CTString {
@@ -81,8 +83,62 @@ private:
     Array m_buf{};
 };
 
+/** Storage layout of MultiMatch transitions */
+enum class MatchLayout {
+    /** Full inputs x states matrix. Fastest to build but mostly empty for a trie */
+    dense,
+    /**
+     Rows overlaid into a single vector, each displaced by a per-state base and
+     tagged with the owning state (a.k.a. double-array). Same O(1) lookup at
+     a fraction of the size.
+     */
+    displaced
+};
+
+struct MatchOptions {
+    MatchLayout layout = MatchLayout::dense;
+    /**
+     Merge states that match the same set of suffixes with the same outcomes.
+     Only states whose payload ids (see makeMultiMatch) are equal are merged.
+     */
+    bool minimize = false;
+    /**
+     Give inputs that lead from every state to the same place a single column of transitions.
+     Typically many letters only ever start or end a string, so this makes rows narrower.
+     Serialized tables and buildTable() leave it out and keep a column per input.
+     */
+    bool mergeInputs = false;
+    /**
+     Let makeMatcher() pick whichever of MultiMatch with either layout, ShiftAndMatch or DirectMatch
+     is estimated to be the fastest for the strings (see MatchPlan). Options above still apply if
+     a MultiMatch is picked. Serialized tables and buildTable() always use the layout given here.
+     makePrefixMapper() without options sets it.
+     */
+    bool selectEngine = false;
+};
+
 namespace Impl {
 
+    /**
+     MaxSize of the construction stages below when their sizes are only known at runtime.
+     They then use std::vector instead of fixed capacity storage.
+     */
+    inline constexpr size_t dynamicSize = size_t(-1);
+
+    template<class T, size_t MaxSize>
+    using VectorFor = std::conditional_t<MaxSize == dynamicSize, std::vector<T>, StaticVector<T, MaxSize>>;
+    template<class T, size_t MaxSize>
+    using ArrayFor = std::conditional_t<MaxSize == dynamicSize, std::vector<T>, std::array<T, MaxSize>>;
+
+    template<class T, size_t N>
+    constexpr void ensureSize(std::array<T, N> & /*arr*/, size_t /*size*/) noexcept
+    {}
+    template<class T>
+    constexpr void ensureSize(std::vector<T> & vec, size_t size) {
+        if (vec.size() < size)
+            vec.resize(size);
+    }
+
     template<class Char, size_t MaxSize>
     struct Inventory {
         struct State  {
@@ -99,73 +155,583 @@ namespace Impl {
             }
         };
 
-        StaticVector<Char, MaxSize> inputs;
-        StaticVector<State, MaxSize> states;
+        static constexpr size_t maxSize = MaxSize;
+
+        VectorFor<Char, MaxSize> inputs;
+        VectorFor<State, MaxSize> states;
         size_t outcomeCount = 0;
     };
 
+    /** Numbers successful states first and intermediate ones from the end, both in sorted order */
+    template<class Char, size_t MaxSize>
+    constexpr void numberStates(Inventory<Char, MaxSize> & inventory) noexcept {
+        inventory.outcomeCount = 0;
+        size_t intermediateCount = inventory.states.size();
+        for(auto & state: inventory.states) {
+            if (state.successful) {
+                state.index = inventory.outcomeCount++;
+            } else {
+                state.index = --intermediateCount;
+            }
+        }
+    }
+
+    template<class Char>
+    constexpr auto totalSize(std::span<const std::basic_string_view<Char>> strings) noexcept -> size_t {
+        size_t ret = 0;
+        for(auto string: strings)
+            ret += string.size();
+        return ret;
+    }
+
+    /**
+     Collects the inputs and all the distinct prefixes of strings.
+     The states refer to the strings which must outlive the inventory.
+     */
+    template<size_t MaxSize, class Char>
+    constexpr auto makeInventory(std::span<const std::basic_string_view<Char>> strings) {
+
+        Inventory<Char, MaxSize> inventory;
+        using State = decltype(inventory)::State;
+
+        //collect everything and sort once rather than keep sorted containers: O(n log n)
+        std::vector<Char> chars;
+        chars.reserve(totalSize(strings));
+        std::vector<State> prefixes;
+        prefixes.reserve(1 + totalSize(strings));
+        prefixes.push_back({});
+        for(size_t idx = 0; idx < strings.size(); ++idx) {
+            auto string = strings[idx];
+            chars.insert(chars.end(), string.begin(), string.end());
+            for (size_t i = 1; i < string.size(); ++i)
+                prefixes.push_back({.str = string.substr(0, i)});
+            prefixes.push_back({.str = string, .payloadIdx = idx, .successful = true});
+        }
+
+        std::sort(chars.begin(), chars.end());
+        for(auto c: std::ranges::subrange(chars.begin(), std::unique(chars.begin(), chars.end())))
+            inventory.inputs.push_back(c);
+
+        std::sort(prefixes.begin(), prefixes.end());
+        for(auto first = prefixes.begin(); first != prefixes.end(); ) {
+            State state{.str = first->str};
+            auto last = first;
+            for ( ; last != prefixes.end() && last->str == state.str; ++last) {
+                //if a string is repeated the last occurrence wins
+                if (last->successful && (!state.successful || last->payloadIdx > state.payloadIdx)) {
+                    state.successful = true;
+                    state.payloadIdx = last->payloadIdx;
+                }
+            }
+            //in sorted order all the longer strings starting with this one immediately follow it
+            state.final = (last == prefixes.end() || !last->str.starts_with(state.str));
+            inventory.states.push_back(state);
+            first = last;
+        }
+
+        numberStates(inventory);
+        return inventory;
+    }
+
     template<CTString First, CTString... Rest>
     requires(SameCharType<First, Rest...>)
     consteval auto makeInventory() {
 
-        constexpr size_t maxSize = 1 + (First.size() + ... + Rest.size());
-        
-        Inventory<CharTypeOf<First>, maxSize> inventory;
-        using State = decltype(inventory)::State;
+        using StringView = std::basic_string_view<CharTypeOf<First>>;
+
+        constexpr StringView strings[] = { {First.begin(), First.size()}, {Rest.begin(), Rest.size()}... };
+        //summed in a loop: g++ evaluates a + fold over thousands of strings in quadratic time
+        constexpr size_t maxSize = 1 + totalSize(std::span<const StringView>(strings));
+
+        return makeInventory<maxSize>(std::span<const StringView>(strings));
+    }
+
+    /**
+     Geometry of the character -> input class lookup table.
+     
+     Characters in the BMP (or all of them for narrower character types) are mapped
+     via a two-level page table: a directory indexed by the high bits points to
+     a page indexed by the low bits. Pages with no inputs all share page 0.
+     Characters outside the directory range fall back to binary search.
+     */
+    template<class Char>
+    struct ClassMapGeometry {
+        using UChar = std::make_unsigned_t<Char>;
         
-        inventory.states.push_back({.final = true});
+        static constexpr size_t pageBits = 8;
+        static constexpr size_t pageSize = size_t(1) << pageBits;
+        static constexpr size_t directLimit = std::min(size_t(std::numeric_limits<UChar>::max()), size_t(0xFFFF)) + 1;
+        static constexpr size_t directorySize = (directLimit + pageSize - 1) / pageSize;
         
-        constexpr std::basic_string_view<CharTypeOf<First>> strings[] =
-            { {First.begin(), First.size()}, {Rest.begin(), Rest.size()}... };
-
-        for(size_t idx = 0; idx < std::size(strings); ++idx) {
+        template<class Inputs>
+        static constexpr auto pageCount(const Inputs & inputs) -> size_t {
+            size_t count = 1;
+            size_t lastPage = size_t(-1);
+            for(auto c: inputs) {
+                auto uc = size_t(UChar(c));
+                if (uc >= directLimit)
+                    break;
+                if (auto page = uc >> pageBits; page != lastPage) {
+                    ++count;
+                    lastPage = page;
+                }
+            }
+            return count;
+        }
+    };
 
-            auto string = strings[idx];
+    /**
+     Class of c in the class map of matcher: its inputs, inputClasses, classDirectory and classPages.
+     See ClassMapGeometry.
+     */
+    template<class Matcher>
+    constexpr auto lookUpClass(const Matcher & matcher, typename Matcher::CharType c) noexcept -> typename Matcher::ClassType {
+        using Char = typename Matcher::CharType;
+        using ClassGeometry = ClassMapGeometry<Char>;
 
-            for (auto c: string) {
-                auto it = std::lower_bound(inventory.inputs.begin(), inventory.inputs.end(), c);
-                if (it == inventory.inputs.end() || *it != c)
-                    inventory.inputs.insert(it, c);
+        auto uc = typename ClassGeometry::UChar(c);
+        if constexpr (sizeof(Char) > 2) {
+            if (uc >= ClassGeometry::directLimit) {
+                auto it = std::lower_bound(matcher.inputs.begin(), matcher.inputs.end(), c);
+                if (it == matcher.inputs.end() || *it != c)
+                    return matcher.noClass;
+                return matcher.inputClasses[it - matcher.inputs.begin()];
             }
+        }
+        auto page = size_t(matcher.classDirectory[uc >> ClassGeometry::pageBits]);
+        return matcher.classPages[(page << ClassGeometry::pageBits) | (uc & (ClassGeometry::pageSize - 1))];
+    }
+
+    /** Fills the class map of matcher, whose inputs are already set, with classes[i] being the class of inputs[i] */
+    template<class Matcher, class Classes>
+    constexpr void fillClassMap(Matcher & matcher, const Classes & classes) {
+        using ClassGeometry = ClassMapGeometry<typename Matcher::CharType>;
+        using ClassType = typename Matcher::ClassType;
+        using PageType = typename Matcher::PageType;
+
+        for(size_t i = 0; i < matcher.inputClasses.size(); ++i)
+            matcher.inputClasses[i] = ClassType(classes[i]);
+        
+        //page 0 is shared by all directory entries that have no inputs
+        std::fill(matcher.classDirectory.begin(), matcher.classDirectory.end(), PageType(0));
+        std::fill(matcher.classPages.begin(), matcher.classPages.end(), matcher.noClass);
+        size_t lastPage = 0;
+        for(size_t i = 0; i < matcher.inputs.size(); ++i) {
+            auto uc = size_t(typename ClassGeometry::UChar(matcher.inputs[i]));
+            if (uc >= ClassGeometry::directLimit)
+                break;
+            auto & page = matcher.classDirectory[uc >> ClassGeometry::pageBits];
+            if (page == 0)
+                page = PageType(++lastPage);
+            matcher.classPages[(size_t(page) << ClassGeometry::pageBits) | (uc & (ClassGeometry::pageSize - 1))] = ClassType(classes[i]);
+        }
+    }
 
-            for (size_t i = 1; i < string.size(); ++i) {
-                State value{.str = {string.begin(), string.begin() + i}, .index = State::notPresent, .payloadIdx = State::notPresent, .successful = false, .final = false};
-                auto it = std::lower_bound(inventory.states.begin(), inventory.states.end(), value);
-                if (it == inventory.states.end() || it->str != value.str) {
-                    it = inventory.states.insert(it, value);
-                } else {
-                    it->final = false;
+    struct Edge {
+        size_t from;
+        /** Index into inputs or, after classifyEdges, the input class */
+        size_t input;
+        size_t to;
+    };
+
+    template<class Char, size_t MaxSize>
+    constexpr auto makeEdges(const Inventory<Char, MaxSize> & inventory) {
+        
+        VectorFor<Edge, MaxSize> edges;
+        std::vector<size_t> stateStack({0});
+        for(size_t i = 1; i < inventory.states.size(); ++i) {
+            auto & state = inventory.states[i];
+            auto newChar = state.str.back();
+            
+            auto it = std::lower_bound(inventory.inputs.begin(), inventory.inputs.end(), newChar);
+            if (it == inventory.inputs.end() || *it != newChar)
+                throw std::logic_error("character not present");
+            size_t charIdx = it - inventory.inputs.begin();
+            
+            for ( ; ; ) {
+                auto & prevState = inventory.states[stateStack.back()];
+                if (state.str.size() == prevState.str.size() + 1 && state.str.substr(0, state.str.size() - 1) == prevState.str) {
+                    edges.push_back({prevState.index, charIdx, state.index});
+                    break;
                 }
+                stateStack.pop_back();
             }
+            stateStack.push_back(i);
+        }
+        return edges;
+    }
 
-            State value{.str = {string.begin(), string.end()}, .index = State::notPresent, .payloadIdx = idx, .successful = true, .final = true};
-            auto it = std::lower_bound(inventory.states.begin(), inventory.states.end(), value);
-            if (it == inventory.states.end() || it->str != value.str) {
-                it = inventory.states.insert(it, value);
-            } else {
-                it->successful = true;
-                it->payloadIdx = idx;
-            }
+    /**
+     Id reported for each matched string. Strings whose payloads are equal can
+     share an id which allows states matching them to be merged.
+     */
+    template<size_t N>
+    struct PayloadIds {
+        std::array<size_t, N> ids;
+
+        static consteval auto identity() -> PayloadIds {
+            PayloadIds ret{};
+            for(size_t i = 0; i < N; ++i)
+                ret.ids[i] = i;
+            return ret;
         }
+    };
 
-        inventory.outcomeCount = 0;
-        size_t intermediateCount = inventory.states.size();
+    /**
+     Matching automaton before it is laid out into tables.
+     Uses the same numbering as MultiMatch: successful states first.
+     */
+    template<size_t MaxSize>
+    struct Automaton {
+        ArrayFor<size_t, MaxSize> payloads{};
+        ArrayFor<bool, MaxSize> finals{};
+        VectorFor<Edge, MaxSize> edges;
+        size_t stateCount = 0;
+        size_t outcomeCount = 0;
+        size_t startState = 0;
+    };
+
+    /** Ids is PayloadIds or anything else with ids[i] giving the id of the i-th string */
+    template<class Char, size_t MaxSize, class Ids>
+    constexpr auto makeAutomaton(const Inventory<Char, MaxSize> & inventory, const Ids & payloadIds) {
+        Automaton<MaxSize> ret;
+        ret.edges = makeEdges(inventory);
+        ret.stateCount = inventory.states.size();
+        ensureSize(ret.payloads, ret.stateCount);
+        ensureSize(ret.finals, ret.stateCount);
+        ret.outcomeCount = inventory.outcomeCount;
+        ret.startState = inventory.states[0].index;
         for(auto & state: inventory.states) {
             if (state.successful) {
-                state.index = inventory.outcomeCount++;
+                ret.payloads[state.index] = payloadIds.ids[state.payloadIdx];
+                ret.finals[state.index] = state.final;
+            }
+        }
+        return ret;
+    }
+
+    /**
+     Merges equivalent states of a trie shaped automaton.
+
+     Two states are equivalent if they are both successful with the same payload or both
+     not successful and their transitions on the same inputs lead to equivalent states.
+     The trie edges are in preorder so walking them backwards visits every state after
+     all of its children.
+     */
+    template<size_t MaxSize>
+    constexpr auto minimize(const Automaton<MaxSize> & source) {
+        constexpr size_t none = size_t(-1);
+        const size_t count = source.stateCount;
+
+        //outgoing edges of each state, still in input order
+        std::vector<size_t> firstEdge(count + 1, 0);
+        for(auto & edge: source.edges)
+            ++firstEdge[edge.from + 1];
+        for(size_t i = 0; i < count; ++i)
+            firstEdge[i + 1] += firstEdge[i];
+        std::vector<Edge> rows(source.edges.size());
+        {
+            std::vector<size_t> filled(firstEdge.begin(), firstEdge.end() - 1);
+            for(auto & edge: source.edges)
+                rows[filled[edge.from]++] = edge;
+        }
+
+        //states in reverse preorder, i.e. children first, and the rank of each in it
+        std::vector<size_t> order;
+        order.reserve(count);
+        for(size_t i = source.edges.size(); i-- > 0; )
+            order.push_back(source.edges[i].to);
+        order.push_back(source.startState);
+        std::vector<size_t> rank(count);
+        for(size_t i = 0; i < count; ++i)
+            rank[order[i]] = i;
+
+        //equivalent states have equal heights and all children of a state are lower
+        //so states can be merged one height at a time by sorting them on their outgoing edges
+        std::vector<size_t> height(count, 0);
+        for(auto state: order) {
+            for(size_t i = firstEdge[state]; i < firstEdge[state + 1]; ++i)
+                height[state] = std::max(height[state], height[rows[i].to] + 1);
+        }
+        //bucket sort by height
+        std::vector<size_t> levelStarts(height[source.startState] + 2, 0);
+        for(auto state: order)
+            ++levelStarts[height[state] + 1];
+        for(size_t i = 1; i < levelStarts.size(); ++i)
+            levelStarts[i] += levelStarts[i - 1];
+        std::vector<size_t> byHeight(count);
+        {
+            auto positions = levelStarts;
+            for(auto state: order)
+                byHeight[positions[height[state]]++] = state;
+        }
+
+        auto successful = [&](size_t state) { return state < source.outcomeCount; };
+        std::vector<size_t> canonical(count, none);
+        auto compare = [&](size_t lhs, size_t rhs) {
+            if (successful(lhs) != successful(rhs))
+                return successful(lhs) ? -1 : 1;
+            if (successful(lhs) && source.payloads[lhs] != source.payloads[rhs])
+                return source.payloads[lhs] < source.payloads[rhs] ? -1 : 1;
+            auto lhsCount = firstEdge[lhs + 1] - firstEdge[lhs];
+            auto rhsCount = firstEdge[rhs + 1] - firstEdge[rhs];
+            if (lhsCount != rhsCount)
+                return lhsCount < rhsCount ? -1 : 1;
+            for(size_t i = firstEdge[lhs], j = firstEdge[rhs]; i < firstEdge[lhs + 1]; ++i, ++j) {
+                if (rows[i].input != rows[j].input)
+                    return rows[i].input < rows[j].input ? -1 : 1;
+                if (canonical[rows[i].to] != canonical[rows[j].to])
+                    return canonical[rows[i].to] < canonical[rows[j].to] ? -1 : 1;
+            }
+            return 0;
+        };
+        for(size_t level = 0; level + 1 < levelStarts.size(); ++level) {
+            auto levelStart = byHeight.begin() + levelStarts[level];
+            auto levelEnd = byHeight.begin() + levelStarts[level + 1];
+            std::sort(levelStart, levelEnd, [&](size_t lhs, size_t rhs) {
+                auto res = compare(lhs, rhs);
+                return res != 0 ? res < 0 : rank[lhs] < rank[rhs];
+            });
+            //the first state of each group of equivalent ones in reverse preorder represents it
+            for(auto first = levelStart; first != levelEnd; ) {
+                auto last = first;
+                for( ; last != levelEnd && compare(*first, *last) == 0; ++last)
+                    canonical[*last] = *first;
+                first = last;
+            }
+        }
+
+        std::vector<size_t> representatives;
+        for(auto state: order) {
+            if (canonical[state] == state)
+                representatives.push_back(state);
+        }
+
+        Automaton<MaxSize> ret;
+        ret.stateCount = representatives.size();
+        ensureSize(ret.payloads, ret.stateCount);
+        ensureSize(ret.finals, ret.stateCount);
+        std::vector<size_t> newIndex(count, none);
+        size_t intermediateCount = ret.stateCount;
+        for(auto rep: representatives) {
+            if (successful(rep)) {
+                newIndex[rep] = ret.outcomeCount++;
+                ret.payloads[newIndex[rep]] = source.payloads[rep];
+                ret.finals[newIndex[rep]] = source.finals[rep];
             } else {
-                state.index = --intermediateCount;
+                newIndex[rep] = --intermediateCount;
             }
         }
+        for(auto rep: representatives) {
+            for(size_t i = firstEdge[rep]; i < firstEdge[rep + 1]; ++i)
+                ret.edges.push_back({newIndex[rep], rows[i].input, newIndex[canonical[rows[i].to]]});
+        }
+        ret.startState = newIndex[canonical[source.startState]];
+        return ret;
+    }
 
-        return inventory;
+    /**
+     Partition of the inputs into classes. Each class is a column of transitions.
+     Classes are numbered in order of their first input.
+     */
+    template<size_t MaxSize>
+    struct InputClasses {
+        ArrayFor<size_t, MaxSize> classes{};
+        size_t count = 0;
+    };
+
+    /** Every input in a class of its own */
+    template<size_t MaxSize>
+    constexpr auto identityClasses(size_t inputCount) {
+        InputClasses<MaxSize> ret;
+        ensureSize(ret.classes, inputCount);
+        for(size_t i = 0; i < inputCount; ++i)
+            ret.classes[i] = i;
+        ret.count = inputCount;
+        return ret;
+    }
+
+    /**
+     Puts inputs into the same class if they have the same transitions from every state.
+     Each input's transitions, ordered by source state, form its signature and inputs are
+     grouped by sorting on it.
+     */
+    template<size_t MaxSize, class Edges>
+    constexpr auto classifyInputs(const Edges & edges, size_t inputCount) {
+        //edges of each input ordered by source state
+        std::vector<size_t> firstEdge(inputCount + 1, 0);
+        for(auto & edge: edges)
+            ++firstEdge[edge.input + 1];
+        for(size_t i = 0; i < inputCount; ++i)
+            firstEdge[i + 1] += firstEdge[i];
+        std::vector<Edge> columns(edges.size());
+        {
+            std::vector<size_t> filled(firstEdge.begin(), firstEdge.end() - 1);
+            for(auto & edge: edges)
+                columns[filled[edge.input]++] = edge;
+        }
+        for(size_t i = 0; i < inputCount; ++i) {
+            std::sort(columns.begin() + firstEdge[i], columns.begin() + firstEdge[i + 1], [](const Edge & lhs, const Edge & rhs) {
+                return lhs.from < rhs.from;
+            });
+        }
+        auto compare = [&](size_t lhs, size_t rhs) {
+            auto lhsCount = firstEdge[lhs + 1] - firstEdge[lhs];
+            auto rhsCount = firstEdge[rhs + 1] - firstEdge[rhs];
+            if (lhsCount != rhsCount)
+                return lhsCount < rhsCount ? -1 : 1;
+            for(size_t i = firstEdge[lhs], j = firstEdge[rhs]; i < firstEdge[lhs + 1]; ++i, ++j) {
+                if (columns[i].from != columns[j].from)
+                    return columns[i].from < columns[j].from ? -1 : 1;
+                if (columns[i].to != columns[j].to)
+                    return columns[i].to < columns[j].to ? -1 : 1;
+            }
+            return 0;
+        };
+
+        std::vector<size_t> order(inputCount);
+        for(size_t i = 0; i < inputCount; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+            auto res = compare(lhs, rhs);
+            return res != 0 ? res < 0 : lhs < rhs;
+        });
+        //the first input of each group represents it
+        std::vector<size_t> representative(inputCount);
+        for(auto first = order.begin(); first != order.end(); ) {
+            auto last = first;
+            for( ; last != order.end() && compare(*first, *last) == 0; ++last)
+                representative[*last] = *first;
+            first = last;
+        }
+
+        constexpr size_t none = size_t(-1);
+        InputClasses<MaxSize> ret;
+        ensureSize(ret.classes, inputCount);
+        for(size_t i = 0; i < inputCount; ++i)
+            ret.classes[i] = (representative[i] == i ? ret.count++ : none);
+        for(size_t i = 0; i < inputCount; ++i)
+            ret.classes[i] = ret.classes[representative[i]];
+        return ret;
+    }
+
+    /**
+     Makes the automaton's edges go on input classes rather than inputs.
+     Edges on all but the first input of each class are dropped as duplicates.
+     */
+    template<size_t MaxSize>
+    constexpr auto classifyEdges(const Automaton<MaxSize> & source, const InputClasses<MaxSize> & classes, size_t inputCount) {
+        std::vector<size_t> firstInput(classes.count);
+        for(size_t i = inputCount; i-- > 0; )
+            firstInput[classes.classes[i]] = i;
+
+        Automaton<MaxSize> ret;
+        ret.payloads = source.payloads;
+        ret.finals = source.finals;
+        ret.stateCount = source.stateCount;
+        ret.outcomeCount = source.outcomeCount;
+        ret.startState = source.startState;
+        for(auto & edge: source.edges) {
+            if (auto cls = classes.classes[edge.input]; firstInput[cls] == edge.input)
+                ret.edges.push_back({edge.from, cls, edge.to});
+        }
+        return ret;
+    }
+
+    template<size_t MaxSize>
+    struct Displacement {
+        ArrayFor<size_t, MaxSize> bases{};
+        size_t slots = 0;
+    };
+
+    /**
+     Places the rows of the given states so that no two of them collide and stores their bases.
+     First-fit, widest rows first. Occupied slots are skipped over rather than probed one by one.
+     Only the rows and bases of these states are touched. Returns one past the last occupied slot.
+     */
+    template<class Bases>
+    constexpr auto placeRows(std::vector<std::vector<size_t>> & rows, std::vector<size_t> & states, Bases & bases) -> size_t {
+        std::sort(states.begin(), states.end(), [&](size_t lhs, size_t rhs) {
+            if (rows[lhs].size() != rows[rhs].size())
+                return rows[lhs].size() > rows[rhs].size();
+            return lhs < rhs;
+        });
+
+        //nextFree[pos] leads, via path compressed links, to the first unoccupied slot at or after pos
+        std::vector<size_t> nextFree;
+        auto findFree = [&](size_t pos) {
+            auto root = pos;
+            while(root < nextFree.size() && nextFree[root] != root)
+                root = nextFree[root];
+            while(pos < nextFree.size() && nextFree[pos] != pos) {
+                auto next = nextFree[pos];
+                nextFree[pos] = root;
+                pos = next;
+            }
+            return root;
+        };
+        auto isFree = [&](size_t pos) {
+            return pos >= nextFree.size() || nextFree[pos] == pos;
+        };
+
+        for(auto state: states) {
+            auto & row = rows[state];
+            if (row.empty())
+                break;
+            std::sort(row.begin(), row.end());
+            //only bases that put the first input in a free slot can fit so skip the rest
+            size_t base;
+            for(auto pos = findFree(row.front()); ; pos = findFree(pos + 1)) {
+                base = pos - row.front();
+                if (std::all_of(row.begin() + 1, row.end(), [&](size_t input) { return isFree(base + input); }))
+                    break;
+            }
+            for(auto input: row) {
+                auto pos = base + input;
+                for(auto i = nextFree.size(); i <= pos; ++i)
+                    nextFree.push_back(i);
+                nextFree[pos] = pos + 1;
+            }
+            bases[state] = base;
+        }
+        return nextFree.size();
+    }
+
+    /**
+     Assigns each state a base offset so that its row, overlaid at that offset,
+     doesn't collide with rows of other states.
+     */
+    template<size_t MaxSize, class Edges>
+    constexpr auto displaceRows(const Edges & edges, size_t stateCount, size_t inputCount) {
+        
+        Displacement<MaxSize> ret;
+        ensureSize(ret.bases, stateCount);
+
+        std::vector<std::vector<size_t>> rows(stateCount);
+        for(auto & edge: edges)
+            rows[edge.from].push_back(edge.input);
+        std::vector<size_t> order(stateCount);
+        for(size_t i = 0; i < stateCount; ++i)
+            order[i] = i;
+        placeRows(rows, order, ret.bases);
+
+        size_t maxBase = 0;
+        for(auto & edge: edges)
+            maxBase = std::max(maxBase, size_t(ret.bases[edge.from]));
+        //any base + any input must stay in range so lookups need no bounds check
+        ret.slots = maxBase + inputCount;
+        return ret;
     }
 
     struct Sizes {
         size_t inputs;
+        size_t classes;
         size_t states;
         size_t outcomes;
         size_t noMatch;
+        size_t classPages;
+        size_t transitionSlots;
+        size_t maxKeyLength;
     };
 
     template<std::unsigned_integral SizeType>
@@ -184,24 +750,64 @@ namespace Impl {
 
         template<size_t MaxValue>
         static constexpr bool isSufficientFor() {
-            return MaxValue <= ~(SizeType(1) << (sizeof(SizeType) * CHAR_BIT - 1));
+            return MaxValue <= size_t(SizeType(~(SizeType(1) << (sizeof(SizeType) * CHAR_BIT - 1))));
         }
     private:
         SizeType m_value = 0;
     };
+
+    template<size_t MaxValue>
+    using UnsignedFor = std::conditional_t<(MaxValue <= std::numeric_limits<unsigned char>::max()),  unsigned char,
+                        std::conditional_t<(MaxValue <= std::numeric_limits<unsigned short>::max()), unsigned short,
+                        std::conditional_t<(MaxValue <= std::numeric_limits<unsigned int>::max()),   unsigned int,
+                                                                                                     size_t>>>;
+
+    template<MatchLayout Layout, class SizeType, Sizes Sizes>
+    struct Transitions;
+
+    template<class SizeType, Sizes Sizes>
+    struct Transitions<MatchLayout::dense, SizeType, Sizes> {
+        std::array<SizeType, Sizes.transitionSlots> cells;
+
+        constexpr auto next(SizeType state, size_t input) const noexcept -> SizeType
+            { return cells[state * Sizes.classes + input]; }
+    };
+
+    template<class SizeType, Sizes Sizes>
+    struct Transitions<MatchLayout::displaced, SizeType, Sizes> {
+        struct Cell {
+            SizeType owner;
+            SizeType target;
+        };
+        using OffsetType = UnsignedFor<Sizes.transitionSlots - Sizes.classes>;
+
+        std::array<OffsetType, Sizes.states> bases;
+        std::array<Cell, Sizes.transitionSlots> cells;
+
+        constexpr auto next(SizeType state, size_t input) const noexcept -> SizeType {
+            auto & cell = cells[bases[state] + input];
+            return cell.owner == state ? cell.target : SizeType(-1);
+        }
+    };
 }
 
-template<class Char, Impl::Sizes Sizes>
+template<class Char, Impl::Sizes Sizes, MatchLayout Layout = MatchLayout::dense>
 requires(Sizes.outcomes > 0)
 struct MultiMatch {
     static constexpr size_t noMatch = Sizes.noMatch;
+    /** Length of the longest string matched. A pending match is always shorter */
+    static constexpr size_t maxKeyLength = Sizes.maxKeyLength;
 
     using CharType = Char;
-    using SizeType = std::conditional_t<Impl::Outcome<unsigned char>::isSufficientFor<Sizes.states>(),        unsigned char,
-                     std::conditional_t<Impl::Outcome<unsigned short>::isSufficientFor<Sizes.states>(),       unsigned short,
-                     std::conditional_t<Impl::Outcome<unsigned int>::isSufficientFor<Sizes.states>(),         unsigned int,
-                     std::conditional_t<Impl::Outcome<unsigned long>::isSufficientFor<Sizes.states>(),        unsigned long,
-                     std::conditional_t<Impl::Outcome<unsigned long long>::isSufficientFor<Sizes.states>(),   unsigned long long,
+private:
+    //states and payload ids must both fit. A minimized automaton can have fewer states than strings
+    static constexpr size_t maxValue = std::max(Sizes.states, Sizes.noMatch);
+public:
+    using SizeType = std::conditional_t<Impl::Outcome<unsigned char>::isSufficientFor<maxValue>(),        unsigned char,
+                     std::conditional_t<Impl::Outcome<unsigned short>::isSufficientFor<maxValue>(),       unsigned short,
+                     std::conditional_t<Impl::Outcome<unsigned int>::isSufficientFor<maxValue>(),         unsigned int,
+                     std::conditional_t<Impl::Outcome<unsigned long>::isSufficientFor<maxValue>(),        unsigned long,
+                     std::conditional_t<Impl::Outcome<unsigned long long>::isSufficientFor<maxValue>(),   unsigned long long,
                      void>>>>>;
     static_assert(!std::is_same_v<SizeType, void>, "Number of states cannot fit in any supported type");
 
@@ -209,58 +815,142 @@ struct MultiMatch {
 
     static constexpr SizeType noState = SizeType(-1);
     
+    using ClassGeometry = Impl::ClassMapGeometry<Char>;
+    using ClassType = std::conditional_t<(Sizes.classes < std::numeric_limits<unsigned char>::max()),  unsigned char,
+                      std::conditional_t<(Sizes.classes < std::numeric_limits<unsigned short>::max()), unsigned short,
+                                                                                                       size_t>>;
+    using PageType = std::conditional_t<(Sizes.classPages <= std::numeric_limits<unsigned char>::max() + 1), unsigned char,
+                                                                                                              unsigned short>;
+    
+    static constexpr ClassType noClass = ClassType(-1);
 
     std::array<Char, Sizes.inputs> inputs;
+    /** Class of each of inputs outside of the class pages. Other characters never need it */
+    std::array<ClassType, (sizeof(Char) > 2 ? Sizes.inputs : 0)> inputClasses;
     std::array<OutcomeType, Sizes.outcomes> outcomes;
     SizeType startState;
-    std::array<SizeType, Sizes.inputs * Sizes.states> transitions;
+    Impl::Transitions<Layout, SizeType, Sizes> transitions;
+    std::array<PageType, ClassGeometry::directorySize> classDirectory;
+    std::array<ClassType, Sizes.classPages * ClassGeometry::pageSize> classPages;
+    
+    /** Returns the class of c or noClass if c is not in inputs */
+    constexpr auto inputClass(Char c) const noexcept -> ClassType
+        { return Impl::lookUpClass(*this, c); }
+
+    /** Returns the state reached from state on input class or noState */
+    constexpr auto next(SizeType state, size_t input) const noexcept -> SizeType
+        { return transitions.next(state, input); }
+
+    /** Whether reaching state is a successful match */
+    constexpr bool accepts(SizeType state) const noexcept
+        { return state < Sizes.outcomes; }
+
+    /** Outcome of an accepting state */
+    constexpr auto outcome(SizeType state) const noexcept -> OutcomeType
+        { return outcomes[state]; }
 };
 
-template<CTString First, CTString... Rest>
-requires(SameCharType<First, Rest...>)
+namespace Impl {
+
+    /** Everything makeMultiMatch() builds the matcher from */
+    template<class Char, size_t MaxSize>
+    struct MultiMatchPlan {
+        Inventory<Char, MaxSize> inventory;
+        InputClasses<MaxSize> classes;
+        Automaton<MaxSize> automaton;
+        Displacement<MaxSize> displacement;
+        Sizes sizes;
+    };
+
+    template<MatchOptions Options, PayloadIds PayloadIds, CTString First, CTString... Rest>
+    requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest))
+    consteval auto planMultiMatch() {
+
+        using Char = CharTypeOf<First>;
+        using ClassGeometry = ClassMapGeometry<Char>;
+
+        auto inventory = makeInventory<First, Rest...>();
+        constexpr size_t maxSize = decltype(inventory)::maxSize;
+        auto trie = makeAutomaton(inventory, PayloadIds);
+        auto minimal = Options.minimize ? minimize(trie) : trie;
+        auto classes = (Options.mergeInputs ? 
+                            classifyInputs<maxSize>(minimal.edges, inventory.inputs.size()) :
+                            identityClasses<maxSize>(inventory.inputs.size()));
+        auto automaton = Options.mergeInputs ? classifyEdges(minimal, classes, inventory.inputs.size()) : minimal;
+        auto displacement = (Options.layout == MatchLayout::displaced ? 
+                                displaceRows<maxSize>(automaton.edges, automaton.stateCount, classes.count) :
+                                Displacement<maxSize>{});
+        size_t transitionSlots = (Options.layout == MatchLayout::displaced ? 
+                                    displacement.slots : 
+                                    classes.count * automaton.stateCount);
+        Sizes sizes{inventory.inputs.size(), classes.count, automaton.stateCount, automaton.outcomeCount, 1 + sizeof...(Rest), 
+                    ClassGeometry::pageCount(inventory.inputs), transitionSlots,
+                    std::max({First.size(), Rest.size()...})};
+        return MultiMatchPlan<Char, maxSize>{inventory, classes, automaton, displacement, sizes};
+    }
+}
+
+/**
+ Builds the matcher for the given strings.
+
+ A successful match reports PayloadIds.ids[i] for the i-th string. By default this is just i.
+ */
+template<MatchOptions Options, Impl::PayloadIds PayloadIds, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest))
 consteval auto makeMultiMatch() {
 
-    constexpr auto inventory = Impl::makeInventory<First, Rest...>();
-    constexpr Impl::Sizes sizes{inventory.inputs.size(), inventory.states.size(), inventory.outcomeCount, 1 + sizeof...(Rest)};
-    MultiMatch<CharTypeOf<First>, sizes> ret{};
+    using Char = CharTypeOf<First>;
+
+    constexpr auto plan = Impl::planMultiMatch<Options, PayloadIds, First, Rest...>();
+    constexpr Impl::Sizes sizes = plan.sizes;
+    const auto & inventory = plan.inventory;
+    const auto & classes = plan.classes;
+    const auto & automaton = plan.automaton;
+    const auto & displacement = plan.displacement;
+    MultiMatch<Char, sizes, Options.layout> ret{};
 
     using SizeType = decltype(ret)::SizeType;
     using OutcomeType = decltype(ret)::OutcomeType;
 
     std::copy(inventory.inputs.begin(), inventory.inputs.end(), ret.inputs.begin());
-    for(auto & state: inventory.states) {
-        if (state.successful) {
-            ret.outcomes[state.index] = OutcomeType{SizeType(state.payloadIdx), state.final};
-        }
-    }
-    ret.startState = SizeType(inventory.states[0].index);
+    Impl::fillClassMap(ret, classes.classes);
+    for(size_t i = 0; i < automaton.outcomeCount; ++i)
+        ret.outcomes[i] = OutcomeType{SizeType(automaton.payloads[i]), automaton.finals[i]};
+    ret.startState = SizeType(automaton.startState);
     
-    std::fill(ret.transitions.begin(), ret.transitions.end(), ret.noState);
-    std::vector<size_t> stateStack({0});
-    for(size_t i = 1; i < inventory.states.size(); ++i) {
-        auto & state = inventory.states[i];
-        auto newChar = state.str.back();
-        
-        auto it = std::lower_bound(inventory.inputs.begin(), inventory.inputs.end(), newChar);
-        if (it == inventory.inputs.end() || *it != newChar)
-            throw std::logic_error("character not present");
-        auto charIdx = it - inventory.inputs.begin();
-        
-        for ( ; ; ) {
-            auto & prevState = inventory.states[stateStack.back()];
-            if (state.str.size() == prevState.str.size() + 1 && state.str.substr(0, state.str.size() - 1) == prevState.str) {
-                ret.transitions[prevState.index * inventory.inputs.size() + charIdx] = SizeType(state.index);
-                break;
-            }
-            stateStack.pop_back();
+    if constexpr (Options.layout == MatchLayout::displaced) {
+        using OffsetType = decltype(ret.transitions)::OffsetType;
+
+        for(size_t i = 0; i < automaton.stateCount; ++i)
+            ret.transitions.bases[i] = OffsetType(displacement.bases[i]);
+        std::fill(ret.transitions.cells.begin(), ret.transitions.cells.end(), 
+                  typename decltype(ret.transitions)::Cell{ret.noState, ret.noState});
+        for(auto & edge: automaton.edges) {
+            auto & cell = ret.transitions.cells[displacement.bases[edge.from] + edge.input];
+            cell.owner = SizeType(edge.from);
+            cell.target = SizeType(edge.to);
         }
-        stateStack.push_back(i);
+    } else {
+        std::fill(ret.transitions.cells.begin(), ret.transitions.cells.end(), ret.noState);
+        for(auto & edge: automaton.edges)
+            ret.transitions.cells[edge.from * classes.count + edge.input] = SizeType(edge.to);
     }
-
     
     return ret;
 }
 
+template<MatchOptions Options, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...>)
+consteval auto makeMultiMatch() {
+    return makeMultiMatch<Options, Impl::PayloadIds<1 + sizeof...(Rest)>::identity(), First, Rest...>();
+}
+
+template<CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...>)
+consteval auto makeMultiMatch() {
+    return makeMultiMatch<MatchOptions{}, First, Rest...>();
+}
+
 template<class It>
 struct PrefixMatchResult {
     /**
@@ -290,7 +980,7 @@ constexpr auto prefixMatch(const Matcher & matcher, Range && r) noexcept -> Pref
     bool final = true;
     for( ; ; ) {
 
-        if (currentState < matcher.outcomes.size()) {
+        if (matcher.accepts(currentState)) {
             consumed = current;
             lastMatchedState = currentState;
         }
@@ -300,13 +990,11 @@ constexpr auto prefixMatch(const Matcher & matcher, Range && r) noexcept -> Pref
             break;
         }
 
-        typename Matcher::CharType c = *current;
-        auto it = std::lower_bound(matcher.inputs.begin(), matcher.inputs.end(), c);
-        if (it == matcher.inputs.end() || *it != c)
+        auto inputIdx = matcher.inputClass(*current);
+        if (inputIdx == matcher.noClass)
             break;
-        size_t inputIdx = it - matcher.inputs.begin();
         
-        auto nextState = matcher.transitions[currentState * matcher.inputs.size() + inputIdx];
+        auto nextState = matcher.next(currentState, inputIdx);
         if (nextState == matcher.noState)
             break;
         
@@ -314,10 +1002,94 @@ constexpr auto prefixMatch(const Matcher & matcher, Range && r) noexcept -> Pref
         ++current;
     }
     if (lastMatchedState != matcher.noState) {
-        auto & outcome = matcher.outcomes[lastMatchedState];
+        auto outcome = matcher.outcome(lastMatchedState);
         return Result{consumed, outcome.value(), final || outcome.final()};
     }
-    return Result{first, Matcher::noMatch, final || matcher.inputs.size() == 0};
+    return Result{first, matcher.noMatch, final || matcher.inputs.size() == 0};
+}
+
+/**
+ Resumable state of a longest prefix match.
+ 
+ Remembers how far into the input the automaton has advanced so that matching
+ can continue when more input becomes available without rescanning what
+ was already consumed. A default constructed cursor is at the start of input.
+ */
+struct MatchCursor {
+    static constexpr size_t none = size_t(-1);
+
+    /** Current automaton state. Meaningless while length == 0 */
+    size_t state = 0;
+    /** Last accepting state passed through or none */
+    size_t matchedState = none;
+    /** Number of input characters consumed */
+    size_t length = 0;
+    /** Number of input characters consumed when matchedState was reached */
+    size_t matchedLength = 0;
+    /** Whether the automaton hit a dead end and will not consume any more */
+    bool stopped = false;
+};
+
+/**
+ Same as prefixMatch but continues from the cursor position.
+ 
+ The range must start at the same place it started when the cursor was
+ fresh with the first cursor.length characters unchanged. Only the characters
+ past them are fed to the automaton.
+ */
+template<class Matcher, std::ranges::forward_range Range>
+requires(std::is_same_v<typename std::ranges::range_value_t<Range>, typename Matcher::CharType>)
+constexpr auto resumeMatch(const Matcher & matcher, MatchCursor & cursor, Range && r) noexcept -> PrefixMatchResult<std::ranges::borrowed_iterator_t<Range>> {
+
+    using Result = PrefixMatchResult<std::ranges::borrowed_iterator_t<Range>>;
+    
+    const auto first = std::ranges::begin(r);
+    const auto last = std::ranges::end(r);
+
+    if (cursor.length == 0) {
+        cursor.state = matcher.startState;
+        cursor.matchedState = MatchCursor::none;
+        cursor.stopped = false;
+    }
+    
+    bool final = cursor.stopped;
+    if (!final) {
+        auto currentState = decltype(matcher.startState)(cursor.state);
+        auto current = std::ranges::next(first, cursor.length, last);
+        for( ; ; ) {
+
+            if (matcher.accepts(currentState)) {
+                cursor.matchedState = currentState;
+                cursor.matchedLength = cursor.length;
+            }
+            
+            if (current == last)
+                break;
+
+            auto inputIdx = matcher.inputClass(*current);
+            if (inputIdx == matcher.noClass) {
+                final = true;
+                break;
+            }
+            
+            auto nextState = matcher.next(currentState, inputIdx);
+            if (nextState == matcher.noState) {
+                final = true;
+                break;
+            }
+            
+            currentState = nextState;
+            ++current;
+            ++cursor.length;
+        }
+        cursor.state = currentState;
+        cursor.stopped = final;
+    }
+    if (cursor.matchedState != MatchCursor::none) {
+        auto outcome = matcher.outcome(decltype(matcher.startState)(cursor.matchedState));
+        return Result{std::ranges::next(first, cursor.matchedLength), outcome.value(), final || outcome.final()};
+    }
+    return Result{first, matcher.noMatch, final || matcher.inputs.size() == 0};
 }
 
 template<class Matcher, std::ranges::forward_range Range>
@@ -326,22 +1098,19 @@ constexpr auto match(const Matcher & matcher, Range && r) noexcept -> size_t {
 
     auto currentState = matcher.startState;
     for(typename Matcher::CharType c: r) {
-        auto it = std::lower_bound(matcher.inputs.begin(), matcher.inputs.end(), c);
-        if (it == matcher.inputs.end() || *it != c)
-            return Matcher::noMatch;
-        size_t inputIdx = it - matcher.inputs.begin();
+        auto inputIdx = matcher.inputClass(c);
+        if (inputIdx == matcher.noClass)
+            return matcher.noMatch;
         
-        auto nextState = matcher.transitions[currentState * matcher.inputs.size() + inputIdx];
+        auto nextState = matcher.next(currentState, inputIdx);
         if (nextState == matcher.noState)
-            return Matcher::noMatch;
+            return matcher.noMatch;
         
         currentState = nextState;
     }
-    if (currentState < matcher.outcomes.size()) {
-        auto & outcome = matcher.outcomes[currentState];
-        return outcome.value();
-    }
-    return Matcher::noMatch;
+    if (matcher.accepts(currentState))
+        return matcher.outcome(currentState).value();
+    return matcher.noMatch;
 }
 
 #ifndef NDEBUG
@@ -350,8 +1119,8 @@ constexpr auto match(const Matcher & matcher, Range && r) noexcept -> size_t {
     #include <iomanip>
     #include <string>
 
-    template<class Char, Impl::Sizes Sizes>
-    void debugPrint(const MultiMatch<Char, Sizes> & val) {
+    template<class Char, Impl::Sizes Sizes, MatchLayout Layout>
+    void debugPrint(const MultiMatch<Char, Sizes, Layout> & val) {
         std::cout << "chars: ";
         for(auto c: val.inputs) {
             std::cout << char(c);
@@ -364,23 +1133,27 @@ constexpr auto match(const Matcher & matcher, Range && r) noexcept -> size_t {
             std::cout << " ";
         }
         std::cout << "\nstart state: " << size_t(val.startState);
+        std::cout << "\nsize: " << sizeof(val) << " bytes";
         std::cout << "\ntransitions:\n";
         size_t maxTrSize = 0;
-        for(auto tr: val.transitions) {
-            if (tr == decltype(tr)(-1))
-                maxTrSize = std::max(maxTrSize, size_t(1));
-            else
-                maxTrSize = std::max(maxTrSize, std::to_string(size_t(tr)).size());
+        for(size_t y = 0; y < Sizes.states; ++y) {
+            for(size_t x = 0; x < Sizes.classes; ++x) {
+                auto tr = val.next(decltype(val.startState)(y), x);
+                if (tr == val.noState)
+                    maxTrSize = std::max(maxTrSize, size_t(1));
+                else
+                    maxTrSize = std::max(maxTrSize, std::to_string(size_t(tr)).size());
+            }
         }
 
         std::ios oldState(nullptr);
         oldState.copyfmt(std::cout);
         std::cout << std::setfill(' ');
         for(size_t y = 0; y < Sizes.states; ++y) {
-                for(size_t x = 0; x < Sizes.inputs; ++x) {
-                auto tr = val.transitions[y * Sizes.inputs + x];
+                for(size_t x = 0; x < Sizes.classes; ++x) {
+                auto tr = val.next(decltype(val.startState)(y), x);
                 std::cout << std::setw(int(maxTrSize));
-                if (tr == decltype(tr)(-1))
+                if (tr == val.noState)
                     std::cout << '*';
                 else
                     std::cout << size_t(tr);
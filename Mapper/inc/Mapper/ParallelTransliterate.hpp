@@ -0,0 +1,110 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_PARALLEL_TRANSLITERATE_HPP_INCLUDED
+#define TRANSLIT_HEADER_PARALLEL_TRANSLITERATE_HPP_INCLUDED
+
+#include "BulkTransliterate.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+struct ParallelOptions {
+    /** Number of threads to use including the calling one. 0 means hardware concurrency */
+    unsigned threads = 0;
+    /** Approximate number of characters each task processes */
+    size_t chunkSize = 256 * 1024;
+};
+
+namespace Impl {
+
+    /**
+     Splits input into chunks of roughly chunkSize that can be transliterated independently
+
+     A split is only made right after a character that is not in the matcher's inputs.
+     No match can cross such a character so the sequential transliteration is back at the
+     start state there. The returned vector holds the chunk boundaries including 0 and in.size()
+     */
+    template<class Matcher, class Char>
+    auto findResyncPoints(const Matcher & matcher, std::basic_string_view<Char> in, size_t chunkSize) -> std::vector<size_t> {
+        std::vector<size_t> ret;
+        ret.reserve(in.size() / chunkSize + 2);
+        ret.push_back(0);
+        for (size_t target = chunkSize; target < in.size(); ) {
+            size_t pos = target;
+            while (pos < in.size() && matcher.inputClass(in[pos]) != matcher.noClass)
+                ++pos;
+            if (pos >= in.size() - 1)
+                break;
+            ret.push_back(pos + 1);
+            target = pos + 1 + chunkSize;
+        }
+        ret.push_back(in.size());
+        return ret;
+    }
+}
+
+/**
+ Transliterates the whole input using multiple threads
+
+ The input is split at resynchronization points (see Impl::findResyncPoints) into tasks that
+ idle threads pick up until none remain. The output is identical to the one produced by
+ the sequential transliterate().
+
+ The output buffer must be at least Mapper::maxExpansion times as large as the input. Each task
+ writes its result in place of its own input range, scaled by that factor, and the results are then
+ compacted. Returns the output size.
+ */
+template<class Mapper>
+requires(std::is_same_v<typename Mapper::Payload, std::basic_string_view<typename Mapper::Char>>)
+auto transliterate(const Mapper & mapper, std::basic_string_view<typename Mapper::Char> in,
+                   std::span<typename Mapper::Char> out, ParallelOptions options) -> size_t {
+
+    using Char = typename Mapper::Char;
+
+    constexpr size_t expansion = Mapper::maxExpansion;
+    if (out.size() / expansion < in.size())
+        throw std::length_error("output buffer is smaller than the largest possible output");
+
+    unsigned threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    size_t chunkSize = std::max(options.chunkSize, size_t(1));
+    if (threads == 1 || in.size() <= chunkSize) {
+        BufferSink<Char> sink(out);
+        transliterate(mapper, in, sink);
+        return sink.size();
+    }
+
+    auto points = Impl::findResyncPoints(Mapper::matcher, in, chunkSize);
+    size_t taskCount = points.size() - 1;
+    std::vector<size_t> sizes(taskCount);
+    std::atomic<size_t> nextTask = 0;
+
+    auto worker = [&]() {
+        for (size_t task = nextTask++; task < taskCount; task = nextTask++) {
+            auto first = points[task], last = points[task + 1];
+            BufferSink<Char> sink(out.subspan(first * expansion, (last - first) * expansion));
+            transliterate(mapper, in.substr(first, last - first), sink);
+            sizes[task] = sink.size();
+        }
+    };
+    {
+        std::vector<std::jthread> pool;
+        pool.reserve(std::min<size_t>(threads, taskCount) - 1);
+        for(size_t i = 1; i < std::min<size_t>(threads, taskCount); ++i)
+            pool.emplace_back(worker);
+        worker();
+    }
+
+    //every task's output fits in its scaled input range so moving them left in order never overwrites unmoved data
+    size_t size = sizes[0];
+    for(size_t task = 1; task < taskCount; ++task) {
+        auto start = out.data() + points[task] * expansion;
+        std::copy(start, start + sizes[task], out.data() + size);
+        size += sizes[task];
+    }
+    return size;
+}
+
+#endif
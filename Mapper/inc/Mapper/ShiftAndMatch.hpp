@@ -0,0 +1,166 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_SHIFT_AND_MATCH_HPP_INCLUDED
+#define TRANSLIT_HEADER_SHIFT_AND_MATCH_HPP_INCLUDED
+
+#include "MultiMatch.hpp"
+
+#include <bit>
+#include <cstdint>
+
+namespace Impl {
+
+    struct ShiftAndSizes {
+        size_t inputs;
+        /** Bits in a state: the start bit and one for every character of every chain */
+        size_t bits;
+        size_t noMatch;
+        size_t classPages;
+        size_t maxKeyLength;
+    };
+
+    /** Most bits a ShiftAndMatch state can have: a machine word */
+    inline constexpr size_t maxShiftAndBits = std::numeric_limits<size_t>::digits;
+
+    /** Bits a ShiftAndMatch for the strings of inventory needs. Each of its final states ends a chain */
+    template<class Char, size_t MaxSize>
+    constexpr auto shiftAndBits(const Inventory<Char, MaxSize> & inventory) noexcept -> size_t {
+        size_t ret = 1;
+        for(auto & state: inventory.states) {
+            if (state.final)
+                ret += state.str.size();
+        }
+        return ret;
+    }
+
+    template<class Char, size_t MaxSize>
+    constexpr auto shiftAndSizes(const Inventory<Char, MaxSize> & inventory, size_t noMatch, size_t maxKeyLength) noexcept -> ShiftAndSizes {
+        return {inventory.inputs.size(), shiftAndBits(inventory), noMatch, ClassMapGeometry<Char>::pageCount(inventory.inputs), maxKeyLength};
+    }
+}
+
+/**
+ Bit-parallel (Shift-And) alternative to MultiMatch for small sets of strings
+
+ Every string that is not a prefix of another one gets a chain of bits, one per character,
+ and strings that are prefixes of it end in the middle of the chain. A state is the set of chain
+ bits reached by all the strings that start with the input consumed so far, or the start bit
+ before anything is consumed. A transition is a shift and an and with the mask of the input so
+ there is no transitions table. Results are the same as those of MultiMatch for the same strings.
+ The state must fit in a machine word, see Impl::maxShiftAndBits.
+ */
+template<class Char, Impl::ShiftAndSizes Sizes>
+requires(Sizes.bits <= Impl::maxShiftAndBits)
+struct ShiftAndMatch {
+    static constexpr size_t noMatch = Sizes.noMatch;
+    /** Length of the longest string matched. A pending match is always shorter */
+    static constexpr size_t maxKeyLength = Sizes.maxKeyLength;
+
+    using CharType = Char;
+    using SizeType = std::conditional_t<(Sizes.bits <= 8),  uint8_t,
+                     std::conditional_t<(Sizes.bits <= 16), uint16_t,
+                     std::conditional_t<(Sizes.bits <= 32), uint32_t,
+                                                            size_t>>>;
+    using PayloadType = Impl::UnsignedFor<Sizes.noMatch>;
+    using OutcomeType = Impl::Outcome<size_t>;
+
+    /** No string starts with the input consumed */
+    static constexpr SizeType noState = 0;
+    /** The start bit. No chain uses bit 0 */
+    static constexpr SizeType startState = 1;
+
+    using ClassGeometry = Impl::ClassMapGeometry<Char>;
+    using ClassType = std::conditional_t<(Sizes.inputs < std::numeric_limits<unsigned char>::max()),  unsigned char,
+                      std::conditional_t<(Sizes.inputs < std::numeric_limits<unsigned short>::max()), unsigned short,
+                                                                                                      size_t>>;
+    using PageType = std::conditional_t<(Sizes.classPages <= std::numeric_limits<unsigned char>::max() + 1), unsigned char,
+                                                                                                              unsigned short>;
+
+    static constexpr ClassType noClass = ClassType(-1);
+
+    std::array<Char, Sizes.inputs> inputs;
+    /** Class of each of inputs outside of the class pages. Every input is a class of its own */
+    std::array<ClassType, (sizeof(Char) > 2 ? Sizes.inputs : 0)> inputClasses;
+    /** Bit of every chain character equal to each of inputs */
+    std::array<SizeType, Sizes.inputs> masks;
+    /** First bit of every chain */
+    SizeType chainStarts;
+    /** Last bit of every chain and the start bit if there are no chains */
+    SizeType chainEnds;
+    /** Bits at which a string ends */
+    SizeType accepting;
+    /** Payload id of the string ending at each of accepting bits */
+    std::array<PayloadType, Sizes.bits> payloads;
+    std::array<PageType, ClassGeometry::directorySize> classDirectory;
+    std::array<ClassType, Sizes.classPages * ClassGeometry::pageSize> classPages;
+
+    /** Returns the class of c or noClass if c is not in inputs */
+    constexpr auto inputClass(Char c) const noexcept -> ClassType
+        { return Impl::lookUpClass(*this, c); }
+
+    /** Returns the state reached from state on input class or noState */
+    constexpr auto next(SizeType state, size_t input) const noexcept -> SizeType {
+        //the start bit goes to the start of every chain and any other bit to the next one in its chain
+        auto fromStart = SizeType(SizeType(0) - (state & 1)) & chainStarts;
+        return SizeType((SizeType((state & ~chainEnds) << 1) | fromStart) & masks[input]);
+    }
+
+    /** Whether reaching state is a successful match */
+    constexpr bool accepts(SizeType state) const noexcept
+        { return (state & accepting) != 0; }
+
+    /** Outcome of an accepting state. All its accepting bits belong to the same string */
+    constexpr auto outcome(SizeType state) const noexcept -> OutcomeType
+        { return OutcomeType(payloads[std::countr_zero(SizeType(state & accepting))], (state & ~chainEnds) == 0); }
+};
+
+/**
+ Builds the bit-parallel matcher for the given strings.
+
+ A successful match reports PayloadIds.ids[i] for the i-th string, same as makeMultiMatch().
+ */
+template<Impl::PayloadIds PayloadIds, CTString First, CTString... Rest>
+requires(SameCharType<First, Rest...> && PayloadIds.ids.size() == 1 + sizeof...(Rest))
+consteval auto makeShiftAndMatch() {
+
+    using Char = CharTypeOf<First>;
+
+    constexpr auto inventory = Impl::makeInventory<First, Rest...>();
+    constexpr auto sizes = Impl::shiftAndSizes(inventory, 1 + sizeof...(Rest), std::max({First.size(), Rest.size()...}));
+    ShiftAndMatch<Char, sizes> ret{};
+
+    using SizeType = decltype(ret)::SizeType;
+    using PayloadType = decltype(ret)::PayloadType;
+    using State = decltype(inventory)::State;
+
+    std::copy(inventory.inputs.begin(), inventory.inputs.end(), ret.inputs.begin());
+    Impl::fillClassMap(ret, Impl::identityClasses<inventory.maxSize>(inventory.inputs.size()).classes);
+
+    auto accept = [&](size_t bit, const State & state) {
+        if (state.successful) {
+            ret.accepting |= SizeType(SizeType(1) << bit);
+            ret.payloads[bit] = PayloadType(PayloadIds.ids[state.payloadIdx]);
+        }
+    };
+    accept(0, inventory.states[0]);
+    if (inventory.states[0].final)
+        ret.chainEnds = 1;
+    size_t bit = 1;
+    for(auto & chain: inventory.states) {
+        if (!chain.final || chain.str.empty())
+            continue;
+        ret.chainStarts |= SizeType(SizeType(1) << bit);
+        for(size_t length = 1; length <= chain.str.size(); ++length, ++bit) {
+            auto input = std::lower_bound(inventory.inputs.begin(), inventory.inputs.end(), chain.str[length - 1]) - inventory.inputs.begin();
+            ret.masks[size_t(input)] |= SizeType(SizeType(1) << bit);
+            //all prefixes are states and in sorted order
+            accept(bit, *std::lower_bound(inventory.states.begin(), inventory.states.end(), State{.str = chain.str.substr(0, length)}));
+        }
+        ret.chainEnds |= SizeType(SizeType(1) << (bit - 1));
+    }
+
+    return ret;
+}
+
+#endif
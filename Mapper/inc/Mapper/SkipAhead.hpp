@@ -0,0 +1,208 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_SKIP_AHEAD_HPP_INCLUDED
+#define TRANSLIT_HEADER_SKIP_AHEAD_HPP_INCLUDED
+
+#include "MultiMatch.hpp"
+
+#include <bit>
+#include <utility>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define TRANSLIT_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TRANSLIT_SIMD_SSE2 1
+#endif
+
+namespace Impl {
+
+    /**
+     Characters that can start a key as up to MaxRanges inclusive ranges
+
+     When the start characters form more runs than that the closest runs are merged
+     so the ranges may also cover characters that cannot start a key.
+     */
+    template<class Char, size_t MaxRanges>
+    struct KeyStartRanges {
+        using UChar = std::make_unsigned_t<Char>;
+
+        size_t count = 0;
+        std::array<UChar, MaxRanges> first{};
+        std::array<UChar, MaxRanges> width{};
+    };
+
+    template<class Matcher>
+    constexpr auto canStartKey(const Matcher & matcher, typename Matcher::CharType c) noexcept -> bool {
+        auto inputIdx = matcher.inputClass(c);
+        return inputIdx != matcher.noClass && matcher.next(matcher.startState, inputIdx) != matcher.noState;
+    }
+
+    template<size_t MaxRanges, class Matcher>
+    consteval auto makeKeyStartRanges(const Matcher & matcher) {
+        using Ranges = KeyStartRanges<typename Matcher::CharType, MaxRanges>;
+        using UChar = typename Ranges::UChar;
+
+        std::vector<UChar> starts;
+        for(auto c: matcher.inputs) {
+            if (canStartKey(matcher, c))
+                starts.push_back(UChar(c));
+        }
+        std::sort(starts.begin(), starts.end());
+
+        std::vector<std::pair<UChar, UChar>> runs;
+        for(auto c: starts) {
+            if (!runs.empty() && size_t(runs.back().second) + 1 == c)
+                runs.back().second = c;
+            else
+                runs.push_back({c, c});
+        }
+        while(runs.size() > MaxRanges) {
+            size_t closest = 0;
+            for(size_t i = 1; i + 1 < runs.size(); ++i) {
+                if (runs[i + 1].first - runs[i].second < runs[closest + 1].first - runs[closest].second)
+                    closest = i;
+            }
+            runs[closest].second = runs[closest + 1].second;
+            runs.erase(runs.begin() + closest + 1);
+        }
+
+        Ranges ret;
+        ret.count = runs.size();
+        for(size_t i = 0; i < runs.size(); ++i) {
+            ret.first[i] = runs[i].first;
+            ret.width[i] = UChar(runs[i].second - runs[i].first);
+        }
+        return ret;
+    }
+
+#if TRANSLIT_SIMD_AVX2 || TRANSLIT_SIMD_SSE2
+
+    /** The widest vector instructions available at compile time over CharSize lanes */
+    template<size_t CharSize>
+    struct Simd {
+    #if TRANSLIT_SIMD_AVX2
+        using Vec = __m256i;
+        static constexpr size_t bytes = 32;
+
+        static auto load(const void * p) noexcept -> Vec
+            { return _mm256_loadu_si256(static_cast<const Vec *>(p)); }
+        static auto zero() noexcept -> Vec
+            { return _mm256_setzero_si256(); }
+        static auto merge(Vec a, Vec b) noexcept -> Vec
+            { return _mm256_or_si256(a, b); }
+        static auto bitmask(Vec v) noexcept -> unsigned
+            { return unsigned(_mm256_movemask_epi8(v)); }
+        //unsigned (v - first) <= width
+        static auto inRange(Vec v, unsigned first, unsigned width) noexcept -> Vec {
+            if constexpr (CharSize == 1) {
+                auto diff = _mm256_sub_epi8(v, _mm256_set1_epi8(char(first)));
+                return _mm256_cmpeq_epi8(_mm256_subs_epu8(diff, _mm256_set1_epi8(char(width))), zero());
+            } else {
+                auto diff = _mm256_sub_epi16(v, _mm256_set1_epi16(short(first)));
+                return _mm256_cmpeq_epi16(_mm256_subs_epu16(diff, _mm256_set1_epi16(short(width))), zero());
+            }
+        }
+    #else
+        using Vec = __m128i;
+        static constexpr size_t bytes = 16;
+
+        static auto load(const void * p) noexcept -> Vec
+            { return _mm_loadu_si128(static_cast<const Vec *>(p)); }
+        static auto zero() noexcept -> Vec
+            { return _mm_setzero_si128(); }
+        static auto merge(Vec a, Vec b) noexcept -> Vec
+            { return _mm_or_si128(a, b); }
+        static auto bitmask(Vec v) noexcept -> unsigned
+            { return unsigned(_mm_movemask_epi8(v)); }
+        //unsigned (v - first) <= width
+        static auto inRange(Vec v, unsigned first, unsigned width) noexcept -> Vec {
+            if constexpr (CharSize == 1) {
+                auto diff = _mm_sub_epi8(v, _mm_set1_epi8(char(first)));
+                return _mm_cmpeq_epi8(_mm_subs_epu8(diff, _mm_set1_epi8(char(width))), zero());
+            } else {
+                auto diff = _mm_sub_epi16(v, _mm_set1_epi16(short(first)));
+                return _mm_cmpeq_epi16(_mm_subs_epu16(diff, _mm_set1_epi16(short(width))), zero());
+            }
+        }
+    #endif
+    };
+
+#endif
+
+    template<const auto & Matcher>
+    struct KeyStartScanner {
+        using Char = typename std::remove_cvref_t<decltype(Matcher)>::CharType;
+
+        static constexpr bool startAccepts = Matcher.accepts(Matcher.startState);
+        static constexpr auto ranges = makeKeyStartRanges<8>(Matcher);
+
+        static constexpr auto scalar(const Char * first, const Char * last) noexcept -> const Char * {
+            for( ; first != last; ++first) {
+                if (canStartKey(Matcher, *first))
+                    break;
+            }
+            return first;
+        }
+
+    #if TRANSLIT_SIMD_AVX2 || TRANSLIT_SIMD_SSE2
+        static auto vector(const Char * first, const Char * last) noexcept -> const Char * {
+            using Simd = Impl::Simd<sizeof(Char)>;
+            constexpr size_t lanes = Simd::bytes / sizeof(Char);
+
+            for( ; size_t(last - first) >= lanes; first += lanes) {
+                auto v = Simd::load(first);
+                auto hits = [&]<size_t... Idx>(std::index_sequence<Idx...>) {
+                    auto ret = Simd::zero();
+                    ((ret = Simd::merge(ret, Simd::inRange(v, ranges.first[Idx], ranges.width[Idx]))), ...);
+                    return ret;
+                }(std::make_index_sequence<ranges.count>());
+                //ranges may be wider than the actual start characters so verify each hit
+                for(auto mask = Simd::bitmask(hits); mask; ) {
+                    auto idx = size_t(std::countr_zero(mask)) / sizeof(Char);
+                    if (canStartKey(Matcher, first[idx]))
+                        return first + idx;
+                    //each character sets sizeof(Char) bits
+                    for(size_t i = 0; i < sizeof(Char); ++i)
+                        mask &= mask - 1;
+                }
+            }
+            return scalar(first, last);
+        }
+    #endif
+
+        static constexpr auto find(const Char * first, const Char * last) noexcept -> const Char * {
+            if constexpr (startAccepts) {
+                return first;
+            } else {
+            #if TRANSLIT_SIMD_AVX2 || TRANSLIT_SIMD_SSE2
+                if constexpr (sizeof(Char) <= 2) {
+                    //in text that is mostly mappable the very next character usually is the one
+                    //so avoid paying for a vector load
+                    if (!std::is_constant_evaluated() && first != last && !canStartKey(Matcher, *first))
+                        return vector(first + 1, last);
+                }
+            #endif
+                return scalar(first, last);
+            }
+        }
+    };
+}
+
+/**
+ Returns the first character in [first, last) that can start a match of Matcher or last
+
+ No match can start at any character before it so they can all be passed through
+ untranslated at once. The scan is vectorized with SSE2 or AVX2, whichever the target
+ supports, for 8 and 16 bit characters. It tests each character against a few ranges
+ derived from the table at compile time and then verifies candidates exactly.
+ */
+template<const auto & Matcher, class Char>
+requires(std::is_same_v<Char, typename std::remove_cvref_t<decltype(Matcher)>::CharType>)
+constexpr auto findKeyStart(const Char * first, const Char * last) noexcept -> const Char * {
+    return Impl::KeyStartScanner<Matcher>::find(first, last);
+}
+
+#endif
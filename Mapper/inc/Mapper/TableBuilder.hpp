@@ -0,0 +1,317 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_TABLE_BUILDER_HPP_INCLUDED
+#define TRANSLIT_HEADER_TABLE_BUILDER_HPP_INCLUDED
+
+#include "FlatTable.hpp"
+
+#include <atomic>
+#include <ranges>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ Incremented whenever buildTable() may produce different bytes for the same mappings and options.
+ Tables cached by TableCache are keyed by it.
+ */
+inline constexpr uint32_t tableBuilderVersion = 1;
+
+struct BuildOptions {
+    /**
+     Number of threads to use including the calling one. 0 means hardware concurrency.
+     The result is the same for any number.
+     */
+    unsigned threads = 1;
+    /**
+     Lay out the transitions reachable through each first character in a separate region of
+     the displaced table. This is much faster for large tables and lets layout use multiple
+     threads but the layout, though not the behavior, then differs from the one makePrefixMapper
+     produces for the same mappings. Has no effect on the dense layout.
+     */
+    bool partitioned = false;
+};
+
+namespace Impl {
+
+    /** payloadIds for makeAutomaton when the number of strings is only known at runtime */
+    struct DynamicPayloadIds {
+        std::vector<size_t> ids;
+    };
+
+    /** Runs task(i) for i in [0, count) on up to threads threads, the calling one included */
+    template<class Task>
+    void runTasks(unsigned threads, size_t count, Task task) {
+        std::atomic<size_t> nextTask = 0;
+        auto worker = [&]() {
+            for (size_t i = nextTask++; i < count; i = nextTask++)
+                task(i);
+        };
+        std::vector<std::jthread> pool;
+        pool.reserve(std::min<size_t>(threads, count) - 1);
+        for(size_t i = 1; i < std::min<size_t>(threads, count); ++i)
+            pool.emplace_back(worker);
+        worker();
+    }
+
+    /**
+     Same as makeInventory<dynamicSize>(strings) but builds the part for each first character
+     on its own thread
+
+     In sorted order the prefixes starting with each character form a contiguous run after the
+     empty one so the parts can be simply concatenated.
+     */
+    template<class Char>
+    auto makeInventoryPartitioned(std::span<const std::basic_string_view<Char>> strings, unsigned threads) {
+        using String = std::basic_string_view<Char>;
+        using Traits = typename String::traits_type;
+
+        std::vector<size_t> byFirst(strings.size());
+        for(size_t i = 0; i < strings.size(); ++i)
+            byFirst[i] = i;
+        std::stable_sort(byFirst.begin(), byFirst.end(), [&](size_t lhs, size_t rhs) {
+            return Traits::lt(strings[lhs][0], strings[rhs][0]);
+        });
+        std::vector<size_t> partStarts;
+        for(size_t i = 0; i < byFirst.size(); ++i) {
+            if (i == 0 || !Traits::eq(strings[byFirst[i]][0], strings[byFirst[i - 1]][0]))
+                partStarts.push_back(i);
+        }
+        partStarts.push_back(byFirst.size());
+
+        std::vector<Inventory<Char, dynamicSize>> parts(partStarts.size() - 1);
+        runTasks(threads, parts.size(), [&](size_t part) {
+            std::vector<String> partStrings;
+            for(size_t i = partStarts[part]; i < partStarts[part + 1]; ++i)
+                partStrings.push_back(strings[byFirst[i]]);
+            parts[part] = makeInventory<dynamicSize>(std::span<const String>(partStrings));
+            //the strings of a part are in their original order so it picks the same winner for duplicates
+            for(auto & state: parts[part].states) {
+                if (state.successful)
+                    state.payloadIdx = byFirst[partStarts[part] + state.payloadIdx];
+            }
+        });
+
+        Inventory<Char, dynamicSize> ret;
+        size_t stateCount = 1;
+        for(auto & part: parts) {
+            ret.inputs.insert(ret.inputs.end(), part.inputs.begin(), part.inputs.end());
+            stateCount += part.states.size() - 1;
+        }
+        std::sort(ret.inputs.begin(), ret.inputs.end());
+        ret.inputs.erase(std::unique(ret.inputs.begin(), ret.inputs.end()), ret.inputs.end());
+        ret.states.reserve(stateCount);
+        ret.states.push_back({});
+        for(auto & part: parts)
+            ret.states.insert(ret.states.end(), part.states.begin() + 1, part.states.end());
+        numberStates(ret);
+        return ret;
+    }
+
+    /**
+     Displaces the rows reachable through each input from the start state separately, on up to
+     threads threads, and puts the results one after another. Start state comes first. A state
+     reachable through several inputs goes with the first of them. The result only depends on the
+     automaton.
+     */
+    template<class Automaton>
+    auto displaceRowsPartitioned(const Automaton & automaton, size_t inputCount, unsigned threads) {
+        Displacement<dynamicSize> ret;
+        ensureSize(ret.bases, automaton.stateCount);
+
+        std::vector<std::vector<size_t>> rows(automaton.stateCount);
+        std::vector<std::vector<size_t>> targets(automaton.stateCount);
+        for(auto & edge: automaton.edges) {
+            rows[edge.from].push_back(edge.input);
+            targets[edge.from].push_back(edge.to);
+        }
+
+        constexpr size_t none = size_t(-1);
+        std::vector<size_t> partOf(automaton.stateCount, none);
+        std::vector<std::vector<size_t>> parts(1, {automaton.startState});
+        partOf[automaton.startState] = 0;
+        {
+            //start state edges in input order
+            std::vector<std::pair<size_t, size_t>> starts;
+            for(size_t i = 0; i < rows[automaton.startState].size(); ++i)
+                starts.push_back({rows[automaton.startState][i], targets[automaton.startState][i]});
+            std::sort(starts.begin(), starts.end());
+            std::vector<size_t> stack;
+            for(auto [input, target]: starts) {
+                if (partOf[target] != none)
+                    continue;
+                auto & part = parts.emplace_back();
+                partOf[target] = parts.size() - 1;
+                stack.push_back(target);
+                while(!stack.empty()) {
+                    auto state = stack.back();
+                    stack.pop_back();
+                    part.push_back(state);
+                    for(auto next: targets[state]) {
+                        if (partOf[next] == none) {
+                            partOf[next] = partOf[state];
+                            stack.push_back(next);
+                        }
+                    }
+                }
+            }
+        }
+
+        //each part is placed from 0 and then moved after the previous ones
+        std::vector<size_t> extents(parts.size());
+        std::vector<size_t> schedule(parts.size());
+        for(size_t i = 0; i < parts.size(); ++i)
+            schedule[i] = i;
+        //biggest parts first so that threads finish at about the same time
+        std::stable_sort(schedule.begin(), schedule.end(), [&](size_t lhs, size_t rhs) {
+            return parts[lhs].size() > parts[rhs].size();
+        });
+        runTasks(threads, parts.size(), [&](size_t task) {
+            auto part = schedule[task];
+            extents[part] = placeRows(rows, parts[part], ret.bases);
+        });
+
+        size_t offset = 0;
+        size_t maxBase = 0;
+        for(size_t part = 0; part < parts.size(); ++part) {
+            for(auto state: parts[part]) {
+                if (!rows[state].empty()) {
+                    ret.bases[state] += offset;
+                    maxBase = std::max(maxBase, ret.bases[state]);
+                }
+            }
+            offset += extents[part];
+        }
+        //any base + any input must stay in range so lookups need no bounds check
+        ret.slots = maxBase + inputCount;
+        return ret;
+    }
+
+    template<class Char>
+    void storeFlatClasses(std::span<const Char> inputs, const FlatTableLayout<Char> & layout, std::vector<std::byte> & bytes) {
+        using ClassGeometry = ClassMapGeometry<Char>;
+
+        //page 0 is shared by all directory entries that have no inputs. bytes start zeroed
+        std::vector<uint32_t> directory(ClassGeometry::directorySize, 0);
+        for(size_t i = 0; i < ClassGeometry::pageCount(inputs) * ClassGeometry::pageSize; ++i)
+            storeFlat(bytes, layout.classPages, i, FlatMatch<Char>::noClass);
+        uint32_t lastPage = 0;
+        for(size_t i = 0; i < inputs.size(); ++i) {
+            auto uc = size_t(typename ClassGeometry::UChar(inputs[i]));
+            if (uc >= ClassGeometry::directLimit)
+                break;
+            auto & page = directory[uc >> ClassGeometry::pageBits];
+            if (page == 0) {
+                page = ++lastPage;
+                storeFlat(bytes, layout.classDirectory, uc >> ClassGeometry::pageBits, page);
+            }
+            storeFlat(bytes, layout.classPages, (size_t(page) << ClassGeometry::pageBits) | (uc & (ClassGeometry::pageSize - 1)), uint32_t(i));
+        }
+    }
+}
+
+/**
+ Builds a mapping table at runtime in the format read by FlatMapper
+
+ mappings is a sequence of (dst, src) pairs of anything convertible to std::basic_string_view,
+ in the same order generate-tables.py passes them to makePrefixMapper. The result is identical,
+ byte for byte, to serializeTable() of the mapper makePrefixMapper builds at compile time from
+ the same pairs and options so it behaves exactly the same. If a src is repeated the last
+ occurrence wins.
+
+ The whole table ends up in the single returned block. The strings are only used during
+ the call. See BuildOptions for building large tables faster.
+ Throws std::invalid_argument if mappings is empty or contains an empty src and
+ std::length_error if the table doesn't fit the format.
+ */
+template<std::ranges::forward_range Mappings>
+auto buildTable(const Mappings & mappings,
+                MatchOptions options = {.layout = MatchLayout::displaced, .minimize = true},
+                BuildOptions buildOptions = {}) -> std::vector<std::byte> {
+
+    using Char = typename std::ranges::range_value_t<Mappings>::first_type::value_type;
+    using String = std::basic_string_view<Char>;
+    using ClassGeometry = Impl::ClassMapGeometry<Char>;
+
+    std::vector<String> dsts, srcs;
+    size_t maxKeyLength = 0;
+    size_t poolSize = 0;
+    for(auto & [dst, src]: mappings) {
+        dsts.push_back(String(dst));
+        srcs.push_back(String(src));
+        if (srcs.back().empty())
+            throw std::invalid_argument("mapping source cannot be empty");
+        maxKeyLength = std::max(maxKeyLength, srcs.back().size());
+        poolSize += dsts.back().size();
+    }
+    if (srcs.empty())
+        throw std::invalid_argument("no mappings");
+
+    unsigned threads = buildOptions.threads ? buildOptions.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    auto inventory = (threads > 1 ?
+                        Impl::makeInventoryPartitioned(std::span<const String>(srcs), threads) :
+                        Impl::makeInventory<Impl::dynamicSize>(std::span<const String>(srcs)));
+    Impl::DynamicPayloadIds payloadIds;
+    payloadIds.ids.resize(srcs.size());
+    for(size_t i = 0; i < srcs.size(); ++i)
+        payloadIds.ids[i] = i;
+    Impl::mergePayloadIds(payloadIds.ids, dsts);
+    auto automaton = Impl::makeAutomaton(inventory, payloadIds);
+    if (options.minimize)
+        automaton = Impl::minimize(automaton);
+    const bool displaced = (options.layout == MatchLayout::displaced);
+    Impl::Displacement<Impl::dynamicSize> displacement;
+    if (displaced && buildOptions.partitioned)
+        displacement = Impl::displaceRowsPartitioned(automaton, inventory.inputs.size(), threads);
+    else if (displaced)
+        displacement = Impl::displaceRows<Impl::dynamicSize>(automaton.edges, automaton.stateCount, inventory.inputs.size());
+    size_t transitionSlots = (displaced ? displacement.slots : inventory.inputs.size() * automaton.stateCount);
+    Impl::checkFlatTableLimits(automaton.stateCount, srcs.size(), transitionSlots, poolSize);
+
+    FlatTableHeader header{};
+    header.magic = FlatTableHeader::signature;
+    header.version = FlatTableHeader::currentVersion;
+    header.charSize = sizeof(Char);
+    header.layout = uint32_t(options.layout);
+    header.inputs = uint32_t(inventory.inputs.size());
+    header.states = uint32_t(automaton.stateCount);
+    header.outcomes = uint32_t(automaton.outcomeCount);
+    header.payloads = uint32_t(srcs.size());
+    header.classPages = uint32_t(ClassGeometry::pageCount(inventory.inputs));
+    header.transitionSlots = uint32_t(transitionSlots);
+    header.maxKeyLength = uint32_t(maxKeyLength);
+    header.startState = uint32_t(automaton.startState);
+    header.poolSize = uint32_t(poolSize);
+
+    auto layout = Impl::FlatTableLayout<Char>::make(header);
+    std::vector<std::byte> ret(size_t(layout.size));
+
+    for(size_t i = 0; i < inventory.inputs.size(); ++i)
+        Impl::storeFlat(ret, layout.inputs, i, inventory.inputs[i]);
+    Impl::storeFlatClasses(std::span<const Char>(inventory.inputs), layout, ret);
+    for(size_t i = 0; i < automaton.outcomeCount; ++i)
+        Impl::storeFlat(ret, layout.outcomes, i, Impl::Outcome<uint32_t>(uint32_t(automaton.payloads[i]), automaton.finals[i]));
+    if (displaced) {
+        for(size_t i = 0; i < automaton.stateCount; ++i)
+            Impl::storeFlat(ret, layout.bases, i, uint32_t(displacement.bases[i]));
+        for(size_t i = 0; i < 2 * transitionSlots; ++i)
+            Impl::storeFlat(ret, layout.cells, i, FlatMatch<Char>::noState);
+        for(auto & edge: automaton.edges) {
+            auto cell = displacement.bases[edge.from] + edge.input;
+            Impl::storeFlat(ret, layout.cells, 2 * cell, uint32_t(edge.from));
+            Impl::storeFlat(ret, layout.cells, 2 * cell + 1, uint32_t(edge.to));
+        }
+    } else {
+        for(size_t i = 0; i < transitionSlots; ++i)
+            Impl::storeFlat(ret, layout.cells, i, FlatMatch<Char>::noState);
+        for(auto & edge: automaton.edges)
+            Impl::storeFlat(ret, layout.cells, edge.from * inventory.inputs.size() + edge.input, uint32_t(edge.to));
+    }
+    Impl::storeFlatPayloads<Char>(dsts, dsts.size(), layout, ret);
+    Impl::sealFlatTable(header, ret);
+    return ret;
+}
+
+#endif
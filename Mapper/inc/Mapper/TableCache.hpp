@@ -0,0 +1,192 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_TABLE_CACHE_HPP_INCLUDED
+#define TRANSLIT_HEADER_TABLE_CACHE_HPP_INCLUDED
+
+#include "TableBuilder.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <span>
+#include <type_traits>
+
+namespace Impl {
+
+    inline constexpr uint64_t fnv64Basis = 0xcbf29ce484222325;
+
+    inline auto fnv64(uint64_t hash, std::span<const std::byte> bytes) noexcept -> uint64_t {
+        for(auto b: bytes) {
+            hash ^= uint64_t(b);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    template<class T>
+    auto fnv64Value(uint64_t hash, const T & value) noexcept -> uint64_t
+        { return fnv64(hash, std::as_bytes(std::span(&value, 1))); }
+}
+
+/** 64-bit FNV-1a of the source a table is built from, e.g. the bytes of a mapping file */
+inline auto tableSourceHash(std::span<const std::byte> source) noexcept -> uint64_t {
+    return Impl::fnv64(Impl::fnv64Basis, source);
+}
+
+/** Hash of (dst, src) pairs as passed to buildTable(). Any change to them, including order, changes it */
+template<std::ranges::forward_range Mappings>
+auto tableSourceHash(const Mappings & mappings) noexcept -> uint64_t {
+    using Char = typename std::ranges::range_value_t<Mappings>::first_type::value_type;
+    using String = std::basic_string_view<Char>;
+
+    uint64_t ret = Impl::fnv64Basis;
+    for(auto & [dst, src]: mappings) {
+        for(String str: {String(dst), String(src)}) {
+            //the length keeps ("ab", "c") and ("a", "bc") apart
+            ret = Impl::fnv64Value(ret, uint64_t(str.size()));
+            ret = Impl::fnv64(ret, std::as_bytes(std::span(str.data(), str.size())));
+        }
+    }
+    return ret;
+}
+
+/**
+ A table obtained from TableCache: either mapped from the cache directory or just built
+ */
+template<class Char>
+class CachedTable {
+public:
+    explicit CachedTable(MappedFile && file):
+        m_file(std::move(file)),
+        m_mapper(m_file->bytes())
+    {}
+    explicit CachedTable(std::vector<std::byte> && bytes):
+        m_built(std::move(bytes)),
+        m_mapper(m_built)
+    {}
+
+    auto mapper() const noexcept -> const FlatMapper<Char> &
+        { return m_mapper; }
+    /** Whether the table was loaded from the cache rather than built */
+    auto fromCache() const noexcept -> bool
+        { return m_file.has_value(); }
+
+private:
+    //both keep the bytes m_mapper refers to in place when moved
+    std::optional<MappedFile> m_file;
+    std::vector<std::byte> m_built;
+    FlatMapper<Char> m_mapper;
+};
+
+/**
+ Directory of tables compiled by buildTable()
+
+ Each table is stored in its own file named after a key derived from the hash of its source, the
+ options it is built with, the character type, tableBuilderVersion and the table format version.
+ Loading a cached table only maps its file so every process using it shares the same pages and
+ pays nothing for parsing or building. A changed source, or a new builder, gets a new key so
+ stale files are never used. They are not deleted either.
+
+ New files are written under a temporary name and renamed into place so concurrent readers see
+ either no file or a complete one. A file that fails FlatMapper validation is treated as missing
+ and replaced. Failures to write the cache are ignored: the table just gets built again next time.
+ */
+class TableCache {
+public:
+    explicit TableCache(std::filesystem::path directory):
+        m_directory(std::move(directory))
+    {}
+
+    auto directory() const noexcept -> const std::filesystem::path &
+        { return m_directory; }
+
+    /**
+     Returns the table for a source with the given hash (see tableSourceHash)
+
+     If the table isn't cached, makeMappings() is called to obtain (dst, src) pairs, e.g. by parsing
+     the source, and the result of buildTable() for them is stored in the cache.
+     */
+    template<class MakeMappings>
+    auto load(uint64_t sourceHash, MakeMappings && makeMappings,
+              MatchOptions options = {.layout = MatchLayout::displaced, .minimize = true}) {
+
+        using Mappings = std::remove_cvref_t<std::invoke_result_t<MakeMappings>>;
+        using Char = typename std::ranges::range_value_t<Mappings>::first_type::value_type;
+
+        auto path = pathFor(key(sourceHash, options, sizeof(Char)));
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec)) {
+            try {
+                return CachedTable<Char>(MappedFile(path));
+            } catch(std::runtime_error &) {
+                //unreadable or invalid: build it again and replace it
+            }
+        }
+        auto bytes = buildTable(makeMappings(), options);
+        store(path, bytes);
+        return CachedTable<Char>(std::move(bytes));
+    }
+
+    /** Same as load(tableSourceHash(mappings), ...) with the given mappings */
+    template<std::ranges::forward_range Mappings>
+    auto load(const Mappings & mappings,
+              MatchOptions options = {.layout = MatchLayout::displaced, .minimize = true}) {
+        return load(tableSourceHash(mappings), [&]() -> const Mappings & { return mappings; }, options);
+    }
+
+    /** Path of the cached file for the given key. Exposed for diagnostics */
+    auto pathFor(uint64_t key) const -> std::filesystem::path {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.tltb", (unsigned long long)key);
+        return m_directory / name;
+    }
+
+    static auto key(uint64_t sourceHash, MatchOptions options, size_t charSize) noexcept -> uint64_t {
+        uint64_t ret = Impl::fnv64Value(Impl::fnv64Basis, sourceHash);
+        ret = Impl::fnv64Value(ret, uint32_t(options.layout));
+        ret = Impl::fnv64Value(ret, uint32_t(options.minimize));
+        ret = Impl::fnv64Value(ret, uint32_t(charSize));
+        ret = Impl::fnv64Value(ret, tableBuilderVersion);
+        ret = Impl::fnv64Value(ret, FlatTableHeader::currentVersion);
+        return ret;
+    }
+
+private:
+    void store(const std::filesystem::path & path, std::span<const std::byte> bytes) const noexcept {
+        std::error_code ec;
+        std::filesystem::path temp;
+        try {
+            std::filesystem::create_directories(m_directory, ec);
+            char suffix[32];
+            snprintf(suffix, sizeof(suffix), ".%08x.tmp", unsigned(std::random_device{}()));
+            temp = path;
+            temp += suffix;
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(bytes.size()));
+                file.close();
+                if (!file)
+                    throw std::runtime_error("unable to write");
+            }
+            //replaces any existing file atomically
+            std::filesystem::rename(temp, path);
+            return;
+        } catch(std::exception &) {
+        }
+        try {
+            if (!temp.empty())
+                std::filesystem::remove(temp, ec);
+        } catch(std::exception &) {
+        }
+    }
+
+private:
+    std::filesystem::path m_directory;
+};
+
+#endif
@@ -5,57 +5,197 @@
 #define TRANSLIT_HEADER_TRANSLITERATOR_HPP_INCLUDED
 
 #include "Mapper.hpp"
+#include "SkipAhead.hpp"
 
-#include <sys_string/sys_string.h>
+#include <string>
 
-class Transliterator {
-private:
+//sys_string char_access is UTF-16 only on Windows. Elsewhere use the StringView overload.
+#ifdef _WIN32
+    #include <sys_string/sys_string.h>
+#endif
+
+struct TransliteratorTypes {
     using Char = char16_t;
     using String = std::basic_string<Char>;
     using StringView = std::basic_string_view<Char>;
     using Iterator = String::const_iterator;
-public:
     using Range = std::ranges::subrange<Iterator>;
-    using MappingFunc = PrefixMappingResult<Char, Iterator> (const Range &);
-    
-    static constexpr MappingFunc * nullMapper = nullPrefixMapper<Char, Range>;
+    using Result = PrefixMappingResult<StringView, Iterator>;
+    using MappingFunc = Result (const Range &);
+    /** Mapper for PrefixMatching::resume. The cursor remembers how much of the pending prefix was already matched */
+    using ResumableMappingFunc = Result (MatchCursor &, const Range &);
+
+    static constexpr MappingFunc * nullMapper = nullPrefixMapper<StringView, Range>;
+    static constexpr ResumableMappingFunc * nullResumableMapper = nullPrefixMapper<StringView, Range>;
+};
+
+/** Mapper can be called like MappingFunc, or like ResumableMappingFunc for PrefixMatching::resume */
+template<class Mapper, PrefixMatching Matching>
+concept TransliteratorMapper = (Matching == PrefixMatching::rescan ?
+    std::is_invocable_r_v<TransliteratorTypes::Result, const Mapper &, const TransliteratorTypes::Range &> :
+    std::is_invocable_r_v<TransliteratorTypes::Result, const Mapper &, MatchCursor &, const TransliteratorTypes::Range &>);
+
+/**
+ Incremental transliterator
+
+ Mapper is anything that can be called like MappingFunc. Transliterator uses a MappingFunc
+ pointer so the table can be chosen at runtime. Instantiating on a concrete table type,
+ e.g. decltype(g_mapperRuDefault<Range>), lets the whole matching loop be inlined.
+ By default every append matches the pending prefix from its start (see PrefixMatching).
+ */
+template<class Mapper, PrefixMatching Matching = PrefixMatching::rescan>
+requires(TransliteratorMapper<Mapper, Matching>)
+class BasicTransliterator : public TransliteratorTypes {
 public:
-    Transliterator() = default;
-    
-    Transliterator(MappingFunc * mapper): m_mapper(mapper)
+    BasicTransliterator() = default;
+
+    BasicTransliterator(Mapper mapper): m_mapper(mapper)
     {}
-    
-    void append(const sysstr::sys_string::char_access & str);
-    
+
+    void append(StringView str) {
+        m_prefix.append(str);
+        process();
+    }
+#ifdef _WIN32
+    void append(const sysstr::sys_string::char_access & str) {
+        m_prefix.append(str.begin(), str.end());
+        process();
+    }
+#endif
+
+    /**
+     Treats the end of input as definite completing everything pending.
+     Afterwards result() is entirely completed.
+     */
+    void finish();
+
     auto result() const -> StringView
         { return m_translit; }
     auto completedSize() const -> size_t
         { return m_translitCompletedSize; }
     auto matchedSomething() const -> bool
         { return m_matchedSomething; }
-    
+
     void clear()  {
         m_prefix.clear();
+        m_cursor = {};
         m_translit.clear();
         m_translitCompletedSize = 0;
         m_matchedSomething = false;
     }
-    
+
     void clearCompleted() {
         m_translit.erase(m_translit.begin(), m_translit.begin() + m_translitCompletedSize);
         m_translitCompletedSize = 0;
         if (m_translit.empty())
             m_matchedSomething = false;
     }
-    
+
+private:
+    void process();
+
+    auto match(Iterator start, Iterator end) -> Result {
+        if constexpr (Matching == PrefixMatching::resume)
+            return m_mapper(m_cursor, Range(start, end));
+        else
+            return m_mapper(Range(start, end));
+    }
+
+    static constexpr auto defaultMapper() -> Mapper {
+        if constexpr (std::is_same_v<Mapper, MappingFunc *>)
+            return nullMapper;
+        else if constexpr (std::is_same_v<Mapper, ResumableMappingFunc *>)
+            return nullResumableMapper;
+        else
+            return Mapper{};
+    }
+
 private:
-    MappingFunc * m_mapper = nullMapper;
-    
+    Mapper m_mapper = defaultMapper();
+
     String m_prefix;
+    MatchCursor m_cursor;
     String m_translit;
     size_t m_translitCompletedSize = 0;
     bool m_matchedSomething = false;
 };
 
+template<class Mapper, PrefixMatching Matching>
+requires(TransliteratorMapper<Mapper, Matching>)
+void BasicTransliterator<Mapper, Matching>::finish() {
+    m_translit.erase(m_translit.begin() + m_translitCompletedSize, m_translit.end());
+
+    const auto end = m_prefix.cend();
+    for (auto start = m_prefix.cbegin(); start != end; ) {
+        auto res = match(start, end);
+        //there is no more input so whatever we have is final
+        if (res.payload) {
+            m_matchedSomething = true;
+            m_translit += *res.payload;
+            start = res.next;
+        } else {
+            m_translit += *start;
+            ++start;
+        }
+        m_translitCompletedSize = m_translit.size();
+        m_cursor = {};
+    }
+    m_prefix.clear();
+}
+
+template<class Mapper, PrefixMatching Matching>
+requires(TransliteratorMapper<Mapper, Matching>)
+void BasicTransliterator<Mapper, Matching>::process() {
+    m_translit.erase(m_translit.begin() + m_translitCompletedSize, m_translit.end());
+
+    const auto begin = m_prefix.cbegin();
+    const auto end = m_prefix.cend();
+    auto completed = begin;
+    for (auto start = begin ; start != end; ) {
+        //when resuming the cursor always starts at start: either fresh or left from
+        //the previous append where start was the beginning of the pending prefix
+        auto res = match(start, end);
+        if (res.payload) {
+            m_matchedSomething = true;
+            m_translit += *res.payload;
+            //if the result is not definite we don't know if a longer match is possible so bail out
+            if (!res.definite)
+                break;
+            //otherwise mark it as completed and continue
+            start = res.next;
+            m_translitCompletedSize = m_translit.size();
+            completed = start;
+        } else if (!res.definite) {
+            //no match but could be with more input, bail out
+            m_matchedSomething = true;
+            m_translit.append(start, end);
+            break;
+        } else  {
+            //no match and couldn't be
+            //consume 1 untranslated char and continue
+            m_translit += *start;
+            ++start;
+            if constexpr (requires { Mapper::matcher; }) {
+                //together with all the following ones that cannot start a match
+                auto first = std::to_address(start);
+                auto next = start + (findKeyStart<Mapper::matcher>(first, std::to_address(end)) - first);
+                m_translit.append(start, next);
+                start = next;
+            }
+            m_translitCompletedSize = m_translit.size();
+            completed = start;
+        }
+        m_cursor = {};
+    }
+    m_prefix.erase(begin, completed);
+}
+
+/**
+ Transliterator over a mapper chosen at runtime
+ */
+using Transliterator = BasicTransliterator<TransliteratorTypes::MappingFunc *>;
+
+//instantiated once in Transliterator.cpp
+extern template class BasicTransliterator<TransliteratorTypes::MappingFunc *>;
 
 #endif
@@ -0,0 +1,122 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_UTF8_MAPPER_HPP_INCLUDED
+#define TRANSLIT_HEADER_UTF8_MAPPER_HPP_INCLUDED
+
+#include "BulkTransliterate.hpp"
+
+namespace Impl {
+
+    /**
+     Calls sink(c) for every code point of a UTF-16 or UTF-32 string
+
+     Unpaired surrogates are passed through as is.
+     */
+    template<class Char, class Sink>
+    requires(sizeof(Char) == 2 || sizeof(Char) == 4)
+    constexpr void forEachCodePoint(std::basic_string_view<Char> str, Sink sink) {
+        for(size_t i = 0; i < str.size(); ++i) {
+            char32_t c = char32_t(str[i]);
+            if constexpr (sizeof(Char) == 2) {
+                if (c >= 0xD800 && c < 0xDC00 && i + 1 < str.size()) {
+                    char32_t next = char32_t(str[i + 1]);
+                    if (next >= 0xDC00 && next < 0xE000) {
+                        c = 0x10000 + ((c - 0xD800) << 10) + (next - 0xDC00);
+                        ++i;
+                    }
+                }
+            }
+            sink(c);
+        }
+    }
+
+    template<class Sink>
+    constexpr void encodeUtf8(char32_t c, Sink sink) {
+        if (c < 0x80) {
+            sink(char(c));
+        } else if (c < 0x800) {
+            sink(char(0xC0 | (c >> 6)));
+            sink(char(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            sink(char(0xE0 | (c >> 12)));
+            sink(char(0x80 | ((c >> 6) & 0x3F)));
+            sink(char(0x80 | (c & 0x3F)));
+        } else {
+            sink(char(0xF0 | (c >> 18)));
+            sink(char(0x80 | ((c >> 12) & 0x3F)));
+            sink(char(0x80 | ((c >> 6) & 0x3F)));
+            sink(char(0x80 | (c & 0x3F)));
+        }
+    }
+
+    template<class Char, size_t N>
+    constexpr auto asCTString(const CTString<Char, N> & str) -> CTString<Char, N>
+        { return str; }
+    template<class Char>
+    constexpr auto asCTString(Char c) -> CTString<Char, 1>
+        { return CTString<Char, 1>({c, Char(0)}); }
+
+    template<class Char, size_t N>
+    constexpr auto utf8Length(const CTString<Char, N> & str) -> size_t {
+        size_t ret = 0;
+        forEachCodePoint(std::basic_string_view<Char>(str.begin(), N), [&](char32_t c) {
+            encodeUtf8(c, [&](char) { ++ret; });
+        });
+        return ret;
+    }
+
+    /** UTF-8 version of a mapping destination or source: a single character or a CTString */
+    template<auto Str>
+    consteval auto toUtf8() {
+        constexpr auto str = asCTString(Str);
+        constexpr size_t length = utf8Length(str);
+        char buf[length + 1] = {};
+        size_t size = 0;
+        forEachCodePoint(std::basic_string_view(str.begin(), str.size()), [&](char32_t c) {
+            encodeUtf8(c, [&](char b) { buf[size++] = b; });
+        });
+        return CTString<char, length>(buf);
+    }
+
+    template<class Mapper>
+    struct Utf8MapperFor;
+
+    template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+    struct Utf8MapperFor<PrefixMapper<Range, Options, First, Rest...>> {
+        using type = PrefixMapper<std::string_view, Options,
+                                  Mapping(toUtf8<First.dst>(), toUtf8<First.src>()),
+                                  Mapping(toUtf8<Rest.dst>(), toUtf8<Rest.src>())...>;
+    };
+}
+
+/**
+ The same mapper over UTF-8 bytes
+
+ Built at compile time from the same mappings as Mapper with every source and destination
+ converted to UTF-8. Its Char is char and payloads are std::string_view so it works with
+ bulk transliterate() directly over std::string_view without transcoding.
+
+ No key starts with a UTF-8 continuation byte so matching never begins in the middle of
+ a character and the result is the UTF-8 encoding of what Mapper produces for the UTF-16
+ encoding of the same text.
+ */
+template<class Mapper>
+using Utf8Mapper = typename Impl::Utf8MapperFor<Mapper>::type;
+
+template<class Mapper>
+constexpr auto makeUtf8Mapper(const Mapper & /*mapper*/) -> Utf8Mapper<Mapper> {
+    return {};
+}
+
+/**
+ Transliterates UTF-8 input to UTF-8 output in one pass using Utf8Mapper<Mapper>
+
+ Same as transliterate() on the UTF-16 mapper but without transcoding either side.
+ */
+template<class Mapper, OutputSink<char> Sink>
+constexpr void transliterateUtf8(const Mapper & mapper, std::string_view in, Sink && out) {
+    transliterate(makeUtf8Mapper(mapper), in, std::forward<Sink>(out));
+}
+
+#endif
@@ -0,0 +1,64 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRANSLIT_HEADER_VARIANT_TRANSLITERATOR_HPP_INCLUDED
+#define TRANSLIT_HEADER_VARIANT_TRANSLITERATOR_HPP_INCLUDED
+
+#include "Transliterator.hpp"
+
+#include <variant>
+
+/**
+ Transliterator over one of a fixed set of mapper types chosen at runtime
+
+ Holds a BasicTransliterator specialized for the chosen mapper so the dispatch
+ happens once per call rather than once per match attempt inside it.
+ A default constructed object, or one constructed from a MappingFunc pointer,
+ holds a plain Transliterator.
+ */
+template<class... Mappers>
+class VariantTransliterator : public TransliteratorTypes {
+public:
+    VariantTransliterator() = default;
+
+    VariantTransliterator(MappingFunc * mapper):
+        m_impl(std::in_place_type<Transliterator>, mapper)
+    {}
+
+    template<class Mapper>
+    requires((std::is_same_v<Mapper, Mappers> || ...))
+    VariantTransliterator(Mapper mapper):
+        m_impl(std::in_place_type<BasicTransliterator<Mapper>>, mapper)
+    {}
+
+    void append(StringView str)
+        { std::visit([&](auto & impl) { impl.append(str); }, m_impl); }
+#ifdef _WIN32
+    void append(const sysstr::sys_string::char_access & str)
+        { std::visit([&](auto & impl) { impl.append(str); }, m_impl); }
+#endif
+
+    /**
+     Treats the end of input as definite completing everything pending.
+     Afterwards result() is entirely completed.
+     */
+    void finish()
+        { std::visit([](auto & impl) { impl.finish(); }, m_impl); }
+
+    auto result() const -> StringView
+        { return std::visit([](auto & impl) { return impl.result(); }, m_impl); }
+    auto completedSize() const -> size_t
+        { return std::visit([](auto & impl) { return impl.completedSize(); }, m_impl); }
+    auto matchedSomething() const -> bool
+        { return std::visit([](auto & impl) { return impl.matchedSomething(); }, m_impl); }
+
+    void clear()
+        { std::visit([](auto & impl) { impl.clear(); }, m_impl); }
+    void clearCompleted()
+        { std::visit([](auto & impl) { impl.clearCompleted(); }, m_impl); }
+
+private:
+    std::variant<Transliterator, BasicTransliterator<Mappers>...> m_impl;
+};
+
+#endif
@@ -0,0 +1,79 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <Mapper/MappedFile.hpp>
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path & path) {
+#ifdef _WIN32
+    //FILE_SHARE_DELETE lets a writer atomically replace the file while it is mapped
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, 
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::system_error(int(GetLastError()), std::system_category(), "unable to open " + path.string());
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        auto err = GetLastError();
+        CloseHandle(file);
+        throw std::system_error(int(err), std::system_category(), "unable to read " + path.string());
+    }
+    m_size = size_t(size.QuadPart);
+    if (m_size != 0) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        auto err = GetLastError();
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        if (!m_data)
+            throw std::system_error(int(err), std::system_category(), "unable to map " + path.string());
+    } else {
+        CloseHandle(file);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "unable to open " + path.string());
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "unable to read " + path.string());
+    }
+    m_size = size_t(st.st_size);
+    if (m_size != 0) {
+        void * data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        int err = errno;
+        close(fd);
+        if (data == MAP_FAILED)
+            throw std::system_error(err, std::generic_category(), "unable to map " + path.string());
+        m_data = data;
+    } else {
+        close(fd);
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+    if (!m_data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(m_data, m_size);
+#endif
+}
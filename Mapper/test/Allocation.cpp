@@ -0,0 +1,83 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Allocation.h"
+#include "Test.h"
+#include "Tables.h"
+
+#include <Mapper/InlineTransliterator.hpp>
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    size_t g_allocations = 0;
+    //when not 0 every this many allocations one fails
+    size_t g_failEvery = 0;
+}
+
+void * operator new(size_t size) {
+    ++g_allocations;
+    if (g_failEvery != 0 && g_allocations % g_failEvery == 0)
+        throw std::bad_alloc();
+    if (void * ret = std::malloc(size ? size : 1))
+        return ret;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * ptr) noexcept
+    { std::free(ptr); }
+
+void operator delete(void * ptr, size_t) noexcept
+    { std::free(ptr); }
+
+void failAllocations(size_t every) noexcept
+    { g_failEvery = every; }
+
+namespace {
+
+    /** Output of Transliterator for keys typed one character at a time */
+    template<class Mapper>
+    auto typeWithTransliterator(std::u16string_view keys) -> std::u16string {
+        BasicTransliterator<Mapper> transliterator;
+        std::u16string ret;
+        for(auto c: keys) {
+            transliterator.append(std::u16string_view(&c, 1));
+            ret += transliterator.result().substr(0, transliterator.completedSize());
+            transliterator.clearCompleted();
+        }
+        transliterator.finish();
+        return ret += transliterator.result();
+    }
+
+    /** Output of InlineTransliterator for the same keys. Returns the number of allocations in out */
+    template<class Mapper>
+    auto typeWithInline(std::u16string_view keys, std::u16string & out) -> size_t {
+        out.clear();
+        out.reserve(keys.size() * Mapper::maxExpansion);
+        auto before = g_allocations;
+        InlineTransliterator<Mapper> transliterator;
+        for(auto c: keys) {
+            transliterator.append(std::u16string_view(&c, 1));
+            out += transliterator.result().substr(0, transliterator.completedSize());
+            transliterator.clearCompleted();
+        }
+        transliterator.finish();
+        out += transliterator.result();
+        return g_allocations - before;
+    }
+}
+
+TEST_CASE(inlineTransliteratorDoesNotAllocate) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        Test::Context context(name);
+
+        std::mt19937 rng(1);
+        auto keys = randomWords(rng, alphabetOf(mapper.matcher), 20'000);
+
+        std::u16string result;
+        CHECK(typeWithInline<Mapper>(keys, result) == 0);
+        CHECK(result == typeWithTransliterator<Mapper>(keys));
+    });
+}
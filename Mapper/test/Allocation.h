@@ -0,0 +1,9 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+
+/** Makes every allocation whose number is a multiple of every throw std::bad_alloc. 0 stops failing */
+void failAllocations(size_t every) noexcept;
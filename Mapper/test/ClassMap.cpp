@@ -0,0 +1,45 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+namespace {
+
+    /** Exactly the characters equal to inputs have a class */
+    template<class Matcher>
+    void checkClassMap(const Matcher & matcher, char32_t limit) {
+        using Char = typename Matcher::CharType;
+
+        for(char32_t c = 0; c < limit; ++c) {
+            auto ch = Char(c);
+            auto it = std::lower_bound(matcher.inputs.begin(), matcher.inputs.end(), ch);
+            auto cls = matcher.inputClass(ch);
+            if (it == matcher.inputs.end() || *it != ch)
+                CHECK(cls == matcher.noClass);
+            else
+                CHECK(cls != matcher.noClass);
+        }
+    }
+}
+
+TEST_CASE(classMapOfShippedTables) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkClassMap(mapper.matcher, 0x10000);
+    });
+}
+
+TEST_CASE(classMapOfWideCharacters) {
+    //characters past the class pages fall back to binary search
+    constexpr auto matcher = makeMultiMatch<U"a", U"\U0001F600", U"\U0001F601x", U"א">();
+    checkClassMap(matcher, 0x20000);
+    CHECK(match(matcher, std::u32string_view(U"\U0001F601x")) == 2);
+    CHECK(match(matcher, std::u32string_view(U"\U0001F602")) == matcher.noMatch);
+}
+
+TEST_CASE(classMapOfNarrowCharacters) {
+    constexpr auto matcher = makeMultiMatch<"ab", "b", "\xE0">();
+    checkClassMap(matcher, 0x100);
+    CHECK(match(matcher, std::string_view("\xE0")) == 2);
+}
@@ -0,0 +1,18 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "Test.h"
+#include "Tables.h"
+
+/** A mapper under test gives the same result for text as the expected one */
+template<class Expected, class Actual>
+void checkSameResult(const Expected & expected, const Actual & actual, const std::u16string & text) {
+    TableRange range(text);
+    auto expectedResult = expected(range);
+    auto actualResult = actual(range);
+    CHECK(actualResult.next == expectedResult.next);
+    CHECK(actualResult.payload == expectedResult.payload);
+    CHECK(actualResult.definite == expectedResult.definite);
+}
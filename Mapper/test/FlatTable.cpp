@@ -0,0 +1,73 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Compare.h"
+
+#include <Mapper/FlatTable.hpp>
+
+#include <stdexcept>
+
+namespace {
+
+    auto readHeader(const std::vector<std::byte> & bytes) -> FlatTableHeader {
+        FlatTableHeader ret;
+        std::memcpy(&ret, bytes.data(), sizeof(ret));
+        return ret;
+    }
+}
+
+TEST_CASE(flatTableRoundTrip) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+
+        auto bytes = serializeTable(mapper);
+        FlatMapper<char16_t> flat(bytes);
+        CHECK(flat.maxExpansion() <= mapper.maxExpansion);
+
+        //keys of either one must be keys of the other with the same results
+        size_t prefixes = 0;
+        forEachKeyPrefix(mapper.matcher, [&](std::u16string_view prefix) {
+            checkSameResult(mapper, flat, std::u16string(prefix));
+            checkSameResult(mapper, flat, std::u16string(prefix) + u" ");
+            ++prefixes;
+        });
+        forEachKeyPrefix(flat.matcher(), [&](std::u16string_view prefix) {
+            checkSameResult(mapper, flat, std::u16string(prefix));
+            --prefixes;
+        });
+        CHECK(prefixes == 0);
+
+        std::mt19937 rng(1);
+        auto alphabet = alphabetOf(mapper.matcher);
+        for(int i = 0; i < 10'000; ++i)
+            checkSameResult(mapper, flat, randomText(rng, alphabet, rng() % 8));
+    });
+}
+
+TEST_CASE(flatTableRejectsCorruption) {
+    auto bytes = serializeTable(g_mapperHeDefault<TableRange>);
+
+    auto truncated = bytes;
+    truncated.resize(truncated.size() - sizeof(uint32_t));
+    CHECK_THROWS(FlatMapper<char16_t>(truncated), std::runtime_error);
+    CHECK_THROWS(FlatMapper<char16_t>(std::span(bytes).first(sizeof(FlatTableHeader) - 1)), std::runtime_error);
+
+    //resealed so that the version and not the checksum is what is wrong
+    auto badVersion = bytes;
+    auto header = readHeader(badVersion);
+    ++header.version;
+    Impl::sealFlatTable(header, badVersion);
+    CHECK_THROWS(FlatMapper<char16_t>(badVersion), std::runtime_error);
+
+    auto badChecksum = bytes;
+    badChecksum.back() ^= std::byte(1);
+    CHECK_THROWS(FlatMapper<char16_t>(badChecksum), std::runtime_error);
+    header = readHeader(bytes);
+    ++header.checksum;
+    std::memcpy(badChecksum.data(), &header, sizeof(header));
+    badChecksum.back() = bytes.back();
+    CHECK_THROWS(FlatMapper<char16_t>(badChecksum), std::runtime_error);
+
+    FlatMapper<char16_t> intact(bytes);
+    CHECK(intact.matcher().maxKeyLength == g_mapperHeDefault<TableRange>.matcher.maxKeyLength);
+}
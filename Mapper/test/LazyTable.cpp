@@ -0,0 +1,141 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Allocation.h"
+#include "Compare.h"
+
+#include <Mapper/LazyTable.hpp>
+#include <Mapper/TableBuilder.hpp>
+
+namespace {
+
+    /** Every key prefix, each followed by a character, and random text over the alphabet */
+    template<class Mappings>
+    auto lazyTestTexts(const Mappings & mappings) -> std::vector<std::u16string> {
+        std::u16string alphabet;
+        std::vector<std::u16string> ret;
+        for(auto & [dst, src]: mappings) {
+            alphabet += src;
+            for(size_t length = 1; length <= src.size(); ++length)
+                ret.push_back(src.substr(0, length));
+        }
+        alphabet += u" .";
+        std::mt19937 rng(1);
+        for(size_t i = 0, count = ret.size(); i < count; ++i)
+            ret.push_back(ret[i] + alphabet[rng() % alphabet.size()]);
+        for(int i = 0; i < 2'000; ++i)
+            ret.push_back(randomText(rng, alphabet, rng() % 12));
+        return ret;
+    }
+
+    /**
+     LazyMapper gives the same results as a FlatMapper over buildTable() with any cache size and
+     its stats add up
+
+     The same texts are matched with every cache size so every table takes the same transitions:
+     as many as the misses without a cache. With a cache large enough for every state each state
+     misses once. A smaller cache fills up and then evicts a row on every further miss.
+     */
+    template<class Mappings>
+    void checkLazyTable(const Mappings & mappings) {
+        auto bytes = buildTable(mappings);
+        FlatMapper<char16_t> expected(bytes);
+        auto texts = lazyTestTexts(mappings);
+
+        auto run = [&](size_t maxCachedStates) {
+            LazyTable<char16_t> table(mappings, LazyTableOptions{.maxCachedStates = maxCachedStates});
+            LazyMapper<char16_t> lazy(table);
+            CHECK(table.stats().peakResidentStates == 0);
+            for(auto & text: texts)
+                checkSameResult(expected, lazy, text);
+            return table.stats();
+        };
+
+        auto uncached = run(0);
+        size_t transitions = uncached.misses;
+        CHECK(transitions > 0);
+        CHECK(uncached.hits == 0);
+        CHECK(uncached.evictions == 0);
+        CHECK(uncached.residentStates == 0);
+        CHECK(uncached.peakResidentStates == 0);
+
+        auto all = run(size_t(1) << 30);
+        size_t states = all.misses;
+        CHECK(all.hits + all.misses == transitions);
+        CHECK(all.hits > 0);
+        CHECK(all.evictions == 0);
+        CHECK(all.residentStates == states);
+        CHECK(all.peakResidentStates == states);
+
+        for(size_t maxCachedStates: {size_t(1), size_t(16)}) {
+            Test::Context context(maxCachedStates == 1 ? "1 state" : "16 states");
+            auto stats = run(maxCachedStates);
+            CHECK(stats.hits + stats.misses == transitions);
+            CHECK(stats.misses >= states);
+            CHECK(stats.residentStates == std::min(maxCachedStates, states));
+            CHECK(stats.peakResidentStates == stats.residentStates);
+            CHECK(stats.evictions == stats.misses - stats.residentStates);
+            CHECK(stats.failedAllocations == 0);
+        }
+    }
+}
+
+TEST_CASE(lazySameAsBuilt) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkLazyTable(mappingsOf(mapper));
+    });
+    Test::Context context("dictionary");
+    checkLazyTable(dictionaryMappings(3'000));
+}
+
+TEST_CASE(lazyResetStats) {
+    auto mappings = mappingsOf(g_mapperRuDefault<TableRange>);
+    LazyTable<char16_t> table(mappings, LazyTableOptions{.maxCachedStates = 4});
+    LazyMapper<char16_t> lazy(table);
+    for(auto & [dst, src]: mappings)
+        lazy(TableRange(src));
+    CHECK(table.stats().residentStates == 4);
+
+    table.resetStats();
+    auto stats = table.stats();
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == 0);
+    CHECK(stats.evictions == 0);
+    CHECK(stats.residentStates == 4);
+    CHECK(stats.peakResidentStates == 4);
+}
+
+TEST_CASE(lazyTableSurvivesAllocationFailure) {
+    auto mappings = dictionaryMappings(2'000);
+    auto bytes = buildTable(mappings);
+    FlatMapper<char16_t> expected(bytes);
+
+    std::mt19937 rng(1);
+    std::vector<std::u16string> texts;
+    for(int i = 0; i < 2'000; ++i)
+        texts.push_back(randomText(rng, u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя", rng() % 10));
+
+    LazyTable<char16_t> table(mappings, LazyTableOptions{.maxCachedStates = 64});
+    LazyMapper<char16_t> lazy(table);
+
+    //from failing every allocation to failing at different steps of adding a row
+    for(size_t failEvery: {1, 2, 3, 7}) {
+        failAllocations(failEvery);
+        for(auto & text: texts)
+            checkSameResult(expected, lazy, text);
+        failAllocations(0);
+        auto stats = table.stats();
+        CHECK(stats.failedAllocations > 0);
+        CHECK(stats.residentStates <= 64);
+    }
+
+    //with memory back rows are cached again and the ones cached before are still right
+    table.resetStats();
+    for(auto & text: texts)
+        checkSameResult(expected, lazy, text);
+    auto stats = table.stats();
+    CHECK(stats.failedAllocations == 0);
+    CHECK(stats.hits > 0);
+    CHECK(stats.residentStates == 64);
+}
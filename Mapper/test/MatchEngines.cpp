@@ -0,0 +1,112 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+namespace {
+
+    /** Keys that are prefixes of other keys and keys sharing a payload, small enough for Shift-And */
+    constexpr auto g_prefixKeysMapper = makePrefixMapper<TableRange,
+        Mapping{u'с', u"s"},
+        Mapping{u'ш', u"sh"},
+        Mapping{u'щ', u"shh"},
+        Mapping{u'ц', u"c"},
+        Mapping{u'ч', u"ch"},
+        Mapping{u'щ', u"sch"},
+        Mapping{u'а', u"a"}
+    >();
+
+    /** Single characters only, some sharing a payload and some far from the others */
+    constexpr auto g_singleCharsMapper = makePrefixMapper<TableRange,
+        Mapping{u'а', u"a"},
+        Mapping{u'б', u"b"},
+        Mapping{u'а', u"A"},
+        Mapping{u'в', u"é"},
+        Mapping{u'г', u"א"},
+        Mapping{u'д', u"￯"}
+    >();
+
+    /**
+     prefixMatch(), match() and resumeMatch() of actual give the same results as those of expected
+
+     The cursor is resumed one character at a time and must agree with matching each prefix of
+     text from scratch.
+     */
+    template<class Expected, class Actual>
+    void checkSameMatch(const Expected & expected, const Actual & actual, std::u16string_view text) {
+        auto expectedResult = prefixMatch(expected, text);
+        auto actualResult = prefixMatch(actual, text);
+        CHECK(actualResult.next == expectedResult.next);
+        CHECK(actualResult.index == expectedResult.index);
+        CHECK(actualResult.definite == expectedResult.definite);
+        CHECK(match(actual, text) == match(expected, text));
+
+        MatchCursor cursor;
+        for(size_t length = 0; length <= text.size(); ++length) {
+            auto prefix = text.substr(0, length);
+            expectedResult = prefixMatch(expected, prefix);
+            actualResult = resumeMatch(actual, cursor, prefix);
+            CHECK(actualResult.next - prefix.begin() == expectedResult.next - prefix.begin());
+            CHECK(actualResult.index == expectedResult.index);
+            CHECK(actualResult.definite == expectedResult.definite);
+        }
+    }
+
+    /**
+     Every engine that can match the strings of mapper, and the one it picked, agrees with the
+     displaced MultiMatch on every key prefix followed by any character and on random text
+     */
+    template<class Mapper>
+    void checkEngines(Mapper mapper) {
+        constexpr auto & plan = Mapper::matchPlan;
+        constexpr auto & expected = EnginesOf<Mapper>::template matcher<MatchEngine::displaced>;
+        auto alphabet = alphabetOf(expected);
+
+        std::vector<std::u16string> texts;
+        forEachKeyPrefix(expected, [&](std::u16string_view prefix) {
+            texts.emplace_back(prefix);
+            for(auto c: alphabet)
+                texts.push_back(std::u16string(prefix) + c);
+        });
+        std::mt19937 rng(1);
+        for(int i = 0; i < 2'000; ++i)
+            texts.push_back(randomText(rng, alphabet, rng() % 12));
+
+        auto check = [&](const char * name, const auto & actual) {
+            Test::Context context(name);
+            for(auto & text: texts)
+                checkSameMatch(expected, actual, text);
+        };
+        check("picked", mapper.matcher);
+        check("dense", EnginesOf<Mapper>::template matcher<MatchEngine::dense>);
+        if constexpr (plan[MatchEngine::bitParallel].available)
+            check("bit-parallel", EnginesOf<Mapper>::template matcher<MatchEngine::bitParallel>);
+        if constexpr (plan[MatchEngine::direct].available)
+            check("direct", EnginesOf<Mapper>::template matcher<MatchEngine::direct>);
+    }
+}
+
+TEST_CASE(enginesSameAsMultiMatch) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkEngines(mapper);
+    });
+    {
+        Test::Context context("prefix keys");
+        checkEngines(g_prefixKeysMapper);
+    }
+    Test::Context context("single characters");
+    checkEngines(g_singleCharsMapper);
+}
+
+TEST_CASE(defaultEngineSelection) {
+    //Hebrew is the only shipped table Shift-And fits and it is no faster there
+    CHECK(decltype(g_mapperHeDefault<TableRange>)::matchPlan[MatchEngine::bitParallel].available);
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        CHECK(decltype(mapper)::matchPlan.engine == MatchEngine::displaced);
+    });
+    CHECK(decltype(g_prefixKeysMapper)::matchPlan.engine == MatchEngine::bitParallel);
+    CHECK(decltype(g_singleCharsMapper)::matchPlan.engine == MatchEngine::direct);
+}
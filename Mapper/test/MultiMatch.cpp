@@ -0,0 +1,116 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Compare.h"
+
+#include <utility>
+
+namespace {
+
+    /** The I-th of count distinct Cyrillic letters, followed by x if Long */
+    template<size_t I, bool Long>
+    constexpr auto numberedKey = []() {
+        if constexpr (Long) {
+            char16_t chars[] = {char16_t(u'Ѐ' + I), u'x', u'\0'};
+            return CTString<char16_t, 2>(chars);
+        } else {
+            char16_t chars[] = {char16_t(u'Ѐ' + I), u'\0'};
+            return CTString<char16_t, 1>(chars);
+        }
+    }();
+
+    /**
+     Count single letter keys followed by the same letters with an x after them. Single letters
+     are then prefixes of other keys so their outcomes are not final.
+     */
+    template<size_t... I>
+    consteval auto makeNumberedMatch(std::index_sequence<I...>) {
+        return makeMultiMatch<MatchOptions{}, numberedKey<I, false>..., numberedKey<I, true>...>();
+    }
+
+    constexpr auto unminimized(MatchOptions options) -> MatchOptions {
+        options.minimize = false;
+        return options;
+    }
+
+    template<class Mapper>
+    using Unminimized = typename Mapper::template WithOptions<unminimized(Mapper::options)>;
+
+    /** ax and bx map to the same letter so a and b, and ax and bx, can share states. cy cannot */
+    constexpr auto g_sharedSuffixMapper = makePrefixMapper<TableRange,
+        Mapping{u'я', u"ax"}, Mapping{u'я', u"bx"}, Mapping{u'ю', u"cy"}
+    >();
+
+    /** Same keys as g_sharedSuffixMapper but every one maps to something else */
+    constexpr auto g_distinctSuffixMapper = makePrefixMapper<TableRange,
+        Mapping{u'я', u"ax"}, Mapping{u'ю', u"bx"}, Mapping{u'э', u"cy"}
+    >();
+}
+
+TEST_CASE(moreThan127Outcomes) {
+    constexpr size_t count = 100;
+    constexpr auto matcher = makeNumberedMatch(std::make_index_sequence<count>());
+    static_assert(matcher.noMatch == 2 * count);
+    //the top bit of an outcome is its final flag so 200 payload ids need more than 8 bits
+    static_assert(sizeof(decltype(matcher)::SizeType) > 1);
+
+    for(size_t i = 0; i < count; ++i) {
+        std::u16string key(1, char16_t(u'Ѐ' + i));
+
+        auto res = prefixMatch(matcher, key);
+        CHECK(res.index == i);
+        CHECK(!res.definite);
+        CHECK(match(matcher, key) == i);
+
+        key += u'x';
+        res = prefixMatch(matcher, key);
+        CHECK(res.index == count + i);
+        CHECK(res.definite);
+        CHECK(match(matcher, key) == count + i);
+    }
+}
+
+TEST_CASE(minimizeStateCounts) {
+    //start, a, b, c, ax, bx, cy
+    using Shared = decltype(g_sharedSuffixMapper);
+    CHECK(Unminimized<Shared>::matchPlan.stats.states == 7);
+    CHECK(Shared::matchPlan.stats.states == 5);
+
+    //only states with equal payloads are merged
+    using Distinct = decltype(g_distinctSuffixMapper);
+    CHECK(Unminimized<Distinct>::matchPlan.stats.states == 7);
+    CHECK(Distinct::matchPlan.stats.states == 7);
+
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        using Mapper = decltype(mapper);
+
+        //without minimizing it is a trie: a state per key prefix and the start
+        size_t prefixes = 0;
+        forEachKeyPrefix(Unminimized<Mapper>::matcher, [&](std::u16string_view) { ++prefixes; });
+        CHECK(Unminimized<Mapper>::matchPlan.stats.states == prefixes + 1);
+        CHECK(Mapper::matchPlan.stats.states <= prefixes + 1);
+    });
+}
+
+TEST_CASE(minimizedSameAsUnminimized) {
+    auto check = [](auto mapper) {
+        using Mapper = decltype(mapper);
+        Unminimized<Mapper> trie;
+
+        forEachKeyPrefix(trie.matcher, [&](std::u16string_view prefix) {
+            checkSameResult(trie, mapper, std::u16string(prefix));
+            checkSameResult(trie, mapper, std::u16string(prefix) + u" ");
+        });
+        std::mt19937 rng(1);
+        auto alphabet = alphabetOf(mapper.matcher);
+        for(int i = 0; i < 10'000; ++i)
+            checkSameResult(trie, mapper, randomText(rng, alphabet, rng() % 8));
+    };
+    forEachShippedTable([&](const char * name, auto mapper) {
+        Test::Context context(name);
+        check(mapper);
+    });
+    Test::Context context("shared suffixes");
+    check(g_sharedSuffixMapper);
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Compare.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+namespace {
+
+    /** N letters of the alphabet over and over */
+    template<size_t N>
+    constexpr auto g_longOutput = []() {
+        char16_t chars[N + 1] = {};
+        for(size_t i = 0; i < N; ++i)
+            chars[i] = char16_t(u'a' + i % 26);
+        return CTString<char16_t, N>(chars);
+    }();
+
+    /**
+     Outputs that repeat, that are prefixes of others and that are too long for 8 bit
+     offsets and lengths
+     */
+    constexpr auto g_pooledMapper = makePrefixMapper<TableRange,
+        Mapping{u"abc", u"a"},
+        Mapping{u"ab", u"b"},
+        Mapping{u"abc", u"c"},
+        Mapping{u"b", u"d"},
+        Mapping{u"bcd", u"e"},
+        Mapping{u'x', u"f"},
+        Mapping{g_longOutput<300>, u"g"},
+        Mapping{g_longOutput<260>, u"hh"},
+        Mapping{u"y", u"hhh"}
+    >();
+
+    template<class Mapper>
+    void checkPayloads(const Mapper & mapper) {
+        auto mappings = mappingsOf(mapper);
+        for(size_t i = 0; i < mappings.size(); ++i) {
+            auto & [dst, src] = mappings[i];
+            CHECK(mapper.mappings[i] == dst);
+            CHECK(mapper(TableRange(src)).payload == dst);
+        }
+    }
+}
+
+TEST_CASE(outputPoolPayloads) {
+    using Pool = std::remove_cvref_t<decltype(g_pooledMapper.mappings)>;
+    static_assert(sizeof(Pool::OffsetType) == 2 && sizeof(Pool::LengthType) == 2);
+
+    checkPayloads(g_pooledMapper);
+
+    //an output equal to or a prefix of another one is stored only as part of it:
+    //abc, ab and the 260 characters all start the 300 and b starts bcd
+    auto & mappings = g_pooledMapper.mappings;
+    CHECK(mappings.chars.size() == 300 + 3 + 1 + 1);
+    for(size_t i: {0, 1, 2, 7})
+        CHECK(mappings[i].data() == mappings[6].data());
+    CHECK(mappings[3].data() == mappings[4].data());
+
+    CHECK(g_pooledMapper.maxExpansion == 300);
+}
+
+TEST_CASE(outputPoolOfShippedTables) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkPayloads(mapper);
+    });
+}
+
+TEST_CASE(flatTableOutputPool) {
+    auto check = [](const FlatMapper<char16_t> & flat, const auto & mappings) {
+        size_t maxLength = 0;
+        for(auto & [dst, src]: mappings) {
+            CHECK(flat(TableRange(src)).payload == dst);
+            maxLength = std::max(maxLength, dst.size());
+        }
+        CHECK(flat.maxExpansion() == maxLength);
+    };
+
+    auto serialized = serializeTable(g_pooledMapper);
+    check(FlatMapper<char16_t>(serialized), mappingsOf(g_pooledMapper));
+
+    auto built = buildTable(mappingsOf(g_pooledMapper));
+    check(FlatMapper<char16_t>(built), mappingsOf(g_pooledMapper));
+
+    //every payload stored at its own offset, well past 16 bits in all
+    auto dictionary = dictionaryMappings(5'000);
+    for(size_t i = 0; i < dictionary.size(); i += 7)
+        dictionary[i].first = std::u16string(i % 300 + 1, char16_t(u'a' + i % 26));
+    auto dictionaryBytes = buildTable(dictionary);
+    check(FlatMapper<char16_t>(dictionaryBytes), dictionary);
+}
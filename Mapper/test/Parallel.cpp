@@ -0,0 +1,70 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+#include <Mapper/ParallelTransliterate.hpp>
+
+namespace {
+
+    template<class Mapper>
+    auto transliterateSequentially(const Mapper & mapper, std::u16string_view in) -> std::u16string {
+        std::u16string ret(in.size() * Mapper::maxExpansion, u'\0');
+        BufferSink<char16_t> sink(ret);
+        transliterate(mapper, in, sink);
+        ret.resize(sink.size());
+        return ret;
+    }
+
+    /** Parallel output equals the sequential one for any number of threads and chunk size */
+    template<class Mapper>
+    void checkSameAsSequential(const Mapper & mapper, std::u16string_view in) {
+        auto expected = transliterateSequentially(mapper, in);
+        for(unsigned threads: {1u, 2u, 3u, 8u}) {
+            for(size_t chunkSize: {size_t(1), size_t(2), size_t(7), size_t(100), in.size(), in.size() + 1}) {
+                std::u16string out(in.size() * Mapper::maxExpansion, u'\0');
+                auto size = transliterate(mapper, in, std::span(out), ParallelOptions{.threads = threads, .chunkSize = chunkSize});
+                out.resize(size);
+                CHECK(out == expected);
+            }
+        }
+    }
+
+    /** Keys much longer than the chunks, so that most chunk ends fall inside one */
+    constexpr auto g_longKeyMapper = makePrefixMapper<TableRange,
+        Mapping{u"1", u"a"},
+        Mapping{u"22", u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"},
+        Mapping{u"333", u"ab"}
+    >();
+}
+
+TEST_CASE(parallelSameAsSequential) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        std::mt19937 rng(1);
+        checkSameAsSequential(mapper, randomWords(rng, alphabetOf(mapper.matcher), 2'000));
+    });
+
+    Test::Context context("long keys");
+    std::mt19937 rng(1);
+    checkSameAsSequential(g_longKeyMapper, randomWords(rng, u"ab", 2'000));
+    std::u16string longKeys;
+    for(int i = 0; i < 40; ++i)
+        longKeys += (i % 3 ? u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab " : u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa.");
+    checkSameAsSequential(g_longKeyMapper, longKeys);
+}
+
+TEST_CASE(resyncPointsFollowNonInputs) {
+    constexpr auto & matcher = g_longKeyMapper.matcher;
+    std::u16string_view in = u"aaaaaaaaaaaab aab.ab";
+    for(size_t chunkSize = 1; chunkSize <= in.size() + 1; ++chunkSize) {
+        auto points = Impl::findResyncPoints(matcher, in, chunkSize);
+        CHECK(points.front() == 0);
+        CHECK(points.back() == in.size());
+        for(size_t i = 1; i + 1 < points.size(); ++i) {
+            CHECK(points[i] > points[i - 1]);
+            CHECK(matcher.inputClass(in[points[i] - 1]) == matcher.noClass);
+        }
+    }
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+#include <Mapper/SkipAhead.hpp>
+#include <Mapper/Utf8Mapper.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+    /**
+     More runs of start characters than the prefilter has ranges, so that merged ranges cover
+     characters that start nothing, and starts with the top bit set in both UTF-16 and UTF-8
+     */
+    constexpr auto g_scatteredMapper = makePrefixMapper<TableRange,
+        Mapping{u'a', u"a"},
+        Mapping{u'b', u"c"},
+        Mapping{u'c', u"e"},
+        Mapping{u'd', u"g"},
+        Mapping{u'e', u"i"},
+        Mapping{u'f', u"kx"},
+        Mapping{u'g', u"m"},
+        Mapping{u'h', u"o"},
+        Mapping{u'i', u"q"},
+        Mapping{u'j', u"s"},
+        Mapping{u'k', u"Ā"},
+        Mapping{u'l', u"翿"},
+        Mapping{u'm', u"耀"},
+        Mapping{u'n', u"￾"}
+    >();
+
+    /** First characters of every key, independently of the matcher */
+    template<class Mapper>
+    auto keyStartsOf(const Mapper & mapper) -> std::set<typename Mapper::Char> {
+        std::set<typename Mapper::Char> ret;
+        for(auto & [dst, src]: mappingsOf(mapper))
+            ret.insert(src[0]);
+        return ret;
+    }
+
+    /**
+     findKeyStart() and the vector scan on its own find the same character as a plain search
+     for a key start
+
+     The text is made of characters that cannot start a key but are close to ones that can:
+     other inputs, characters inside and on both sides of every prefilter range and the extremes
+     of Char. Every length up to three of the widest vectors is tried with a key start at every
+     position, or none, and from starting points on both sides of a vector boundary.
+     */
+    template<class Mapper>
+    void checkKeyStart(const Mapper & mapper) {
+        using Char = typename Mapper::Char;
+        using UChar = std::make_unsigned_t<Char>;
+        constexpr auto & matcher = Mapper::matcher;
+        using Scanner = Impl::KeyStartScanner<matcher>;
+
+        auto starts = keyStartsOf(mapper);
+        for(auto c: matcher.inputs)
+            CHECK(Impl::canStartKey(matcher, c) == starts.contains(c));
+
+        std::vector<Char> others;
+        auto addOther = [&](size_t c) {
+            if (c <= std::numeric_limits<UChar>::max() && !starts.contains(Char(c)))
+                others.push_back(Char(c));
+        };
+        for(auto c: matcher.inputs)
+            addOther(UChar(c));
+        for(size_t i = 0; i < Scanner::ranges.count; ++i) {
+            size_t first = Scanner::ranges.first[i];
+            size_t last = first + Scanner::ranges.width[i];
+            for(size_t c: {first - 1, last + 1, first + 1, (first + last) / 2, last - 1})
+                addOther(c);
+        }
+        for(size_t c: {size_t(0), size_t(0x7F), size_t(0x80), size_t(std::numeric_limits<UChar>::max())})
+            addOther(c);
+        std::vector<Char> startChars(starts.begin(), starts.end());
+
+        auto check = [&](const std::vector<Char> & text) {
+            for(size_t offset: {0, 1, 2, 7, 8, 15, 16, 17, 31, 32, 33}) {
+                if (offset > text.size())
+                    break;
+                auto first = text.data() + offset;
+                auto last = text.data() + text.size();
+                auto expected = std::find_if(first, last, [&](Char c) { return starts.contains(c); });
+                CHECK(findKeyStart<matcher>(first, last) == expected);
+                CHECK(Scanner::scalar(first, last) == expected);
+            #if TRANSLIT_SIMD_AVX2 || TRANSLIT_SIMD_SSE2
+                if constexpr (sizeof(Char) <= 2)
+                    CHECK(Scanner::vector(first, last) == expected);
+            #endif
+            }
+        };
+
+        std::mt19937 rng(1);
+        for(size_t length = 0; length <= 3 * 32 + 2; ++length) {
+            std::vector<Char> text(length);
+            for(auto & c: text)
+                c = others[rng() % others.size()];
+            check(text);
+            for(size_t pos = 0; pos < length; ++pos) {
+                auto saved = text[pos];
+                text[pos] = startChars[rng() % startChars.size()];
+                check(text);
+                text[pos] = saved;
+            }
+        }
+    }
+}
+
+TEST_CASE(keyStartSameAsPlainSearch) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkKeyStart(mapper);
+        Test::Context utf8Context("UTF-8");
+        checkKeyStart(makeUtf8Mapper(mapper));
+    });
+
+    Test::Context context("scattered");
+    CHECK(Impl::KeyStartScanner<g_scatteredMapper.matcher>::ranges.count == 8);
+    checkKeyStart(g_scatteredMapper);
+    Test::Context utf8Context("UTF-8");
+    checkKeyStart(makeUtf8Mapper(g_scatteredMapper));
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Compare.h"
+
+#include <Mapper/TableBuilder.hpp>
+
+#include <stdexcept>
+
+namespace {
+
+    /** Keys sharing long prefixes with outputs of different lengths, unlike the shipped tables */
+    constexpr auto g_overlapMapper = makePrefixMapper<TableRange,
+        Mapping{u'1', u"a"},
+        Mapping{u"22", u"ab"},
+        Mapping{u'3', u"abc"},
+        Mapping{u"\U0001F600", u"abcd"},
+        Mapping{u'5', u"bcd"},
+        Mapping{u'6', u"cd"},
+        Mapping{u"77", u"bb"},
+        Mapping{u'8', u"abab"},
+        Mapping{u'9', u"ababa"},
+        Mapping{u'1', u"x"},
+        Mapping{u'2', u"ab"}
+    >();
+
+    /**
+     Table built at runtime from the mappings of mapper against mapper itself: on every prefix
+     of every key, alone and followed by each input, and on random text
+     */
+    template<class Mapper>
+    void checkBuiltLikeCompiled(const Mapper & mapper) {
+        auto mappings = mappingsOf(mapper);
+        auto bytes = buildTable(mappings, mapper.options);
+        FlatMapper<char16_t> built(bytes);
+
+        auto alphabet = alphabetOf(mapper.matcher);
+        for(auto & [dst, src]: mappings) {
+            for(size_t length = 1; length <= src.size(); ++length) {
+                auto prefix = src.substr(0, length);
+                checkSameResult(mapper, built, prefix);
+                for(auto c: alphabet)
+                    checkSameResult(mapper, built, prefix + c);
+            }
+        }
+
+        std::mt19937 rng(1);
+        for(int i = 0; i < 10'000; ++i)
+            checkSameResult(mapper, built, randomText(rng, alphabet, rng() % 12));
+
+        //buildTable() promises the same bytes serializeTable() produces
+        CHECK(bytes == serializeTable(mapper));
+    }
+
+    /** Options of mapper with another layout, as a mapper type */
+    template<class Mapper, MatchLayout Layout>
+    using WithLayout = typename Mapper::template WithOptions<[]() {
+        auto ret = Mapper::options;
+        ret.layout = Layout;
+        return ret;
+    }()>;
+}
+
+TEST_CASE(buildTableMatchesCompiled) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        using Mapper = decltype(mapper);
+        Test::Context context(name);
+        {
+            Test::Context layout("dense");
+            checkBuiltLikeCompiled(WithLayout<Mapper, MatchLayout::dense>{});
+        }
+        {
+            Test::Context layout("displaced");
+            checkBuiltLikeCompiled(WithLayout<Mapper, MatchLayout::displaced>{});
+        }
+    });
+    Test::Context context("overlapping keys");
+    checkBuiltLikeCompiled(g_overlapMapper);
+}
+
+TEST_CASE(buildTableRejectsBadMappings) {
+    using Mappings = std::vector<std::pair<std::u16string, std::u16string>>;
+    CHECK_THROWS(buildTable(Mappings{}), std::invalid_argument);
+    CHECK_THROWS(buildTable(Mappings{{u"a", u"b"}, {u"c", u""}}), std::invalid_argument);
+}
+
+TEST_CASE(buildTableSameForAnyThreads) {
+    auto mappings = dictionaryMappings(5'000);
+    for(auto layout: {MatchLayout::dense, MatchLayout::displaced}) {
+        Test::Context context(layout == MatchLayout::dense ? "dense" : "displaced");
+        const MatchOptions options{.layout = layout, .minimize = true};
+        for(bool partitioned: {false, true}) {
+            Test::Context partitioning(partitioned ? "partitioned" : "whole");
+            auto expected = buildTable(mappings, options, BuildOptions{.threads = 1, .partitioned = partitioned});
+            for(unsigned threads: {2, 3, 8})
+                CHECK(buildTable(mappings, options, BuildOptions{.threads = threads, .partitioned = partitioned}) == expected);
+        }
+    }
+}
+
+TEST_CASE(buildTablePartitionedSameAsWhole) {
+    auto mappings = dictionaryMappings(5'000);
+
+    //partitioning only changes where displaced rows go
+    const MatchOptions dense{.layout = MatchLayout::dense, .minimize = true};
+    CHECK(buildTable(mappings, dense, BuildOptions{.threads = 4, .partitioned = true}) == buildTable(mappings, dense));
+
+    const MatchOptions displaced{.layout = MatchLayout::displaced, .minimize = true};
+    auto wholeBytes = buildTable(mappings, displaced);
+    auto partitionedBytes = buildTable(mappings, displaced, BuildOptions{.threads = 4, .partitioned = true});
+    FlatMapper<char16_t> whole(wholeBytes), partitioned(partitionedBytes);
+
+    for(auto & [dst, src]: mappings) {
+        for(size_t length = 1; length <= src.size(); ++length)
+            checkSameResult(whole, partitioned, src.substr(0, length));
+    }
+    std::mt19937 rng(1);
+    auto alphabet = alphabetOf(whole.matcher());
+    for(int i = 0; i < 10'000; ++i)
+        checkSameResult(whole, partitioned, randomText(rng, alphabet, rng() % 12));
+}
+
+TEST_CASE(serializedTablesKeepAColumnPerInput) {
+    auto mappings = mappingsOf(g_mapperHeDefault<TableRange>);
+    constexpr MatchOptions merged{.layout = MatchLayout::displaced, .minimize = true, .mergeInputs = true};
+    CHECK(buildTable(mappings, merged) == buildTable(mappings));
+
+    using Mapper = decltype(g_mapperHeDefault<TableRange>);
+    CHECK(serializeTable(Mapper::WithOptions<merged>{}) == buildTable(mappings));
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+#include <Mapper/TableCache.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    constexpr MatchOptions g_cacheOptions{.layout = MatchLayout::displaced, .minimize = true};
+
+    /** A new directory under the system temporary one, removed with everything in it at the end */
+    class TempDirectory {
+    public:
+        TempDirectory() {
+            char name[32];
+            std::snprintf(name, sizeof(name), "mapper-test-%08x", unsigned(std::random_device{}()));
+            m_path = fs::temp_directory_path() / name;
+        }
+        ~TempDirectory() {
+            std::error_code ec;
+            fs::remove_all(m_path, ec);
+        }
+        TempDirectory(const TempDirectory &) = delete;
+        TempDirectory & operator=(const TempDirectory &) = delete;
+
+        auto path() const -> const fs::path &
+            { return m_path; }
+
+    private:
+        fs::path m_path;
+    };
+
+    auto readFile(const fs::path & path) -> std::vector<std::byte> {
+        std::vector<std::byte> ret(fs::file_size(path));
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char *>(ret.data()), std::streamsize(ret.size()));
+        return ret;
+    }
+
+    /** Writes a new file in place of any existing one, as another process would */
+    void replaceFile(const fs::path & path, const std::vector<std::byte> & bytes) {
+        fs::remove(path);
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(bytes.size()));
+    }
+
+    auto filesIn(const fs::path & directory) -> std::vector<fs::path> {
+        std::vector<fs::path> ret;
+        for(auto & entry: fs::directory_iterator(directory))
+            ret.push_back(entry.path());
+        return ret;
+    }
+
+    template<class Mappings>
+    void checkTable(const CachedTable<char16_t> & table, const Mappings & mappings) {
+        for(auto & [dst, src]: mappings)
+            CHECK(table.mapper()(TableRange(src)).payload == dst);
+    }
+
+    template<class Mappings>
+    auto cachePath(const TableCache & cache, const Mappings & mappings) -> fs::path {
+        return cache.pathFor(TableCache::key(tableSourceHash(mappings), g_cacheOptions, sizeof(char16_t)));
+    }
+
+    template<class T>
+    void patchHeader(std::vector<std::byte> & bytes, size_t offset, T value) {
+        std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+}
+
+TEST_CASE(tableCacheBuildsOnceThenMaps) {
+    TempDirectory temp;
+    TableCache cache(temp.path() / "cache");
+    auto mappings = mappingsOf(g_mapperRuDefault<TableRange>);
+
+    auto built = cache.load(mappings);
+    CHECK(!built.fromCache());
+    checkTable(built, mappings);
+
+    //just the table, no temporary files left behind
+    auto path = cachePath(cache, mappings);
+    CHECK(filesIn(cache.directory()) == std::vector<fs::path>{path});
+    CHECK(readFile(path) == buildTable(mappings, g_cacheOptions));
+
+    auto cached = cache.load(mappings);
+    CHECK(cached.fromCache());
+    checkTable(cached, mappings);
+
+    //a different source or different options are a different table
+    auto other = mappingsOf(g_mapperUkDefault<TableRange>);
+    CHECK(!cache.load(other).fromCache());
+    CHECK(cache.load(other).fromCache());
+    CHECK(!cache.load(mappings, MatchOptions{.layout = MatchLayout::dense, .minimize = true}).fromCache());
+    CHECK(filesIn(cache.directory()).size() == 3);
+}
+
+TEST_CASE(tableCacheRebuildsInvalidFiles) {
+    using Corrupt = std::function<void (std::vector<std::byte> &)>;
+    const std::pair<const char *, Corrupt> corruptions[] = {
+        {"empty", [](auto & bytes) { bytes.clear(); }},
+        {"truncated header", [](auto & bytes) { bytes.resize(sizeof(FlatTableHeader) / 2); }},
+        {"truncated", [](auto & bytes) { bytes.resize(bytes.size() / 2); }},
+        {"bad signature", [](auto & bytes) { bytes[0] ^= std::byte(1); }},
+        {"flipped bit", [](auto & bytes) { bytes[bytes.size() / 2] ^= std::byte(0x40); }},
+        {"newer version", [](auto & bytes) {
+            patchHeader(bytes, offsetof(FlatTableHeader, version), FlatTableHeader::currentVersion + 1);
+        }},
+        {"older version", [](auto & bytes) {
+            patchHeader(bytes, offsetof(FlatTableHeader, version), FlatTableHeader::currentVersion - 1);
+        }},
+        {"wrong character size", [](auto & bytes) {
+            patchHeader(bytes, offsetof(FlatTableHeader, charSize), uint32_t(sizeof(char32_t)));
+        }}
+    };
+
+    TempDirectory temp;
+    TableCache cache(temp.path());
+    auto mappings = mappingsOf(g_mapperHeDefault<TableRange>);
+    auto path = cachePath(cache, mappings);
+    cache.load(mappings);
+    auto good = readFile(path);
+
+    for(auto & [name, corrupt]: corruptions) {
+        Test::Context context(name);
+        auto bytes = good;
+        corrupt(bytes);
+        replaceFile(path, bytes);
+
+        auto rebuilt = cache.load(mappings);
+        CHECK(!rebuilt.fromCache());
+        checkTable(rebuilt, mappings);
+        CHECK(readFile(path) == good);
+        CHECK(cache.load(mappings).fromCache());
+    }
+    CHECK(filesIn(temp.path()).size() == 1);
+}
+
+TEST_CASE(tableCacheReplacesAtomically) {
+    TempDirectory temp;
+    TableCache cache(temp.path());
+    auto ru = mappingsOf(g_mapperRuDefault<TableRange>);
+    auto he = mappingsOf(g_mapperHeDefault<TableRange>);
+    constexpr uint64_t hash = 1;
+    auto path = cache.pathFor(TableCache::key(hash, g_cacheOptions, sizeof(char16_t)));
+
+    //Another process misses the same table at the same time, stores it first and maps it. Then
+    //this one stores its own over it. Different mappings under the same hash make any change to
+    //the mapped bytes visible.
+    std::optional<CachedTable<char16_t>> mapped;
+    auto replacing = cache.load(hash, [&]() -> const auto & {
+        CHECK(!cache.load(hash, [&]() -> const auto & { return ru; }).fromCache());
+        mapped.emplace(cache.load(hash, [&]() -> const auto & { return ru; }));
+        CHECK(mapped->fromCache());
+        return he;
+    });
+    CHECK(!replacing.fromCache());
+    checkTable(replacing, he);
+
+    //the mapped table is the old file, untouched, and the file is now the new table
+    checkTable(*mapped, ru);
+    CHECK(readFile(path) == buildTable(he, g_cacheOptions));
+    auto reloaded = cache.load(hash, [&]() -> const auto & { return ru; });
+    CHECK(reloaded.fromCache());
+    checkTable(reloaded, he);
+    CHECK(filesIn(temp.path()) == std::vector<fs::path>{path});
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <Mapper/Transliterator.hpp>
+
+#include "../../Translit/tables/TableBE.hpp"
+#include "../../Translit/tables/TableHE.hpp"
+#include "../../Translit/tables/TableRU.hpp"
+#include "../../Translit/tables/TableUK.hpp"
+
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using TableRange = TransliteratorTypes::Range;
+
+/** Calls func(name, mapper) for every table in Translit/tables, named as in translit-cli */
+template<class Func>
+void forEachShippedTable(Func && func) {
+    func("be", g_mapperBeDefault<TableRange>);
+    func("be-translit-ru", g_mapperBeTranslitRu<TableRange>);
+    func("he", g_mapperHeDefault<TableRange>);
+    func("ru", g_mapperRuDefault<TableRange>);
+    func("ru-translit-ru", g_mapperRuTranslitRu<TableRange>);
+    func("uk", g_mapperUkDefault<TableRange>);
+    func("uk-translit-ru", g_mapperUkTranslitRu<TableRange>);
+}
+
+/** The (dst, src) pairs mapper was made from, in the form buildTable() takes */
+template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+auto mappingsOf(PrefixMapper<Range, Options, First, Rest...>) {
+    using String = std::basic_string<CharTypeOf<First.src>>;
+    return std::vector<std::pair<String, String>>{
+        {String(Impl::outputView(First.dst)), String(First.src.begin(), First.src.size())},
+        {String(Impl::outputView(Rest.dst)), String(Rest.src.begin(), Rest.src.size())}...
+    };
+}
+
+/** Every engine makeMatcher() can build for the strings of a mapper, regardless of its options */
+template<class Mapper>
+struct EnginesOf;
+
+template<std::ranges::forward_range Range, MatchOptions Options, Mapping First, Mapping... Rest>
+struct EnginesOf<PrefixMapper<Range, Options, First, Rest...>> {
+    using Mapper = PrefixMapper<Range, Options, First, Rest...>;
+
+    /** Only usable if Mapper::matchPlan[Engine].available */
+    template<MatchEngine Engine>
+    static constexpr auto matcher = []() {
+        if constexpr (Engine == MatchEngine::direct)
+            return makeDirectMatch<Mapper::payloadIds, First.src, Rest.src...>();
+        else if constexpr (Engine == MatchEngine::bitParallel)
+            return makeShiftAndMatch<Mapper::payloadIds, First.src, Rest.src...>();
+        else
+            return makeMultiMatch<Impl::withLayout(Options, Engine == MatchEngine::dense ? MatchLayout::dense : MatchLayout::displaced),
+                                  Mapper::payloadIds, First.src, Rest.src...>();
+    }();
+};
+
+/** Every input of matcher followed by extra characters, typically ones that are not inputs */
+template<class Matcher>
+auto alphabetOf(const Matcher & matcher, std::u16string_view extra = u" .,1") -> std::u16string {
+    std::u16string ret(matcher.inputs.begin(), matcher.inputs.end());
+    ret += extra;
+    return ret;
+}
+
+/** length characters drawn uniformly from alphabet */
+inline auto randomText(std::mt19937 & rng, std::u16string_view alphabet, size_t length) -> std::u16string {
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::u16string ret(length, u'\0');
+    for(auto & c: ret)
+        c = alphabet[pick(rng)];
+    return ret;
+}
+
+/** Words of 1 to 8 characters drawn from letters, separated by single spaces, about length characters in all */
+inline auto randomWords(std::mt19937 & rng, std::u16string_view letters, size_t length) -> std::u16string {
+    std::uniform_int_distribution<size_t> wordLength(1, 8);
+    std::u16string ret;
+    ret.reserve(length + 9);
+    while(ret.size() < length) {
+        ret += randomText(rng, letters, wordLength(rng));
+        ret += u' ';
+    }
+    return ret;
+}
+
+/** Calls func(prefix) for every string that takes matcher from its start state to another state: every prefix of every key */
+template<class Matcher, class Func>
+void forEachKeyPrefix(const Matcher & matcher, Func && func) {
+    using Char = typename Matcher::CharType;
+    std::basic_string<Char> prefix;
+    auto visit = [&](auto & self, auto state) -> void {
+        for(auto c: matcher.inputs) {
+            auto next = matcher.next(state, matcher.inputClass(c));
+            if (next == matcher.noState)
+                continue;
+            prefix.push_back(c);
+            func(std::basic_string_view<Char>(prefix));
+            self(self, next);
+            prefix.pop_back();
+        }
+    };
+    visit(visit, matcher.startState);
+}
+
+/** count distinct Cyrillic keys of 1 to 8 characters mapped to two Latin letters, like a dictionary table */
+inline auto dictionaryMappings(size_t count) -> std::vector<std::pair<std::u16string, std::u16string>> {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> keyLength(1, 8);
+    std::set<std::u16string> seen;
+    std::vector<std::pair<std::u16string, std::u16string>> ret;
+    while(ret.size() < count) {
+        auto src = randomText(rng, u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя", keyLength(rng));
+        if (seen.insert(src).second)
+            ret.push_back({randomText(rng, u"abcdefghijklmnopqrstuvwxyz", 2), src});
+    }
+    return ret;
+}
+
+/** Longest matches one after another, skipping characters nothing matches. Returns the sum of matched indices */
+template<class Matcher>
+auto greedyPass(const Matcher & matcher, std::u16string_view text) -> size_t {
+    size_t ret = 0;
+    for(auto it = text.begin(); it != text.end(); ) {
+        auto res = prefixMatch(matcher, std::ranges::subrange(it, text.end()));
+        if (res.index != matcher.noMatch) {
+            ret += res.index;
+            it = res.next;
+        } else {
+            ++it;
+        }
+    }
+    return ret;
+}
+
+/** Feeds text one character at a time as an IME does, resuming from a cursor. Returns the sum of matched indices */
+template<class Matcher>
+auto keystrokePass(const Matcher & matcher, std::u16string_view text) -> size_t {
+    size_t ret = 0;
+    size_t start = 0;
+    MatchCursor cursor;
+    for(size_t end = 1; end <= text.size(); ++end) {
+        while(start < end) {
+            auto pending = text.substr(start, end - start);
+            auto res = resumeMatch(matcher, cursor, pending);
+            if (!res.definite)
+                break;
+            if (res.index != matcher.noMatch) {
+                ret += res.index;
+                start += size_t(res.next - pending.begin());
+            } else {
+                ++start;
+            }
+            cursor = {};
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdio>
+#include <exception>
+
+/**
+ Minimal self-registering test cases
+
+ Every TEST_CASE in any source file of the test executable runs unless a name filter is
+ given on the command line. A failed CHECK is reported and the case carries on.
+ */
+namespace Test {
+
+    struct Case {
+        const char * name;
+        void (*func)();
+        Case * next = nullptr;
+    };
+
+    /** Adds the case to the ones main() runs. Returns true so it can initialize a static */
+    bool add(Case & testCase) noexcept;
+
+    /** Records a failure of the running case */
+    void fail(const char * file, int line, const char * what) noexcept;
+
+    /**
+     Labels failures reported while it is alive, e.g. with the table being checked.
+     Nested ones are reported innermost first.
+     */
+    class Context {
+    public:
+        explicit Context(const char * label) noexcept;
+        ~Context() noexcept;
+        Context(const Context &) = delete;
+        Context & operator=(const Context &) = delete;
+
+        static void print(std::FILE * fp) noexcept;
+    private:
+        const char * m_label;
+        Context * m_outer;
+    };
+}
+
+#define TEST_CONCAT_IMPL(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_IMPL(a, b)
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static Test::Case TEST_CONCAT(name, Case){#name, name}; \
+    [[maybe_unused]] static const bool TEST_CONCAT(name, Added) = Test::add(TEST_CONCAT(name, Case)); \
+    static void name()
+
+#define CHECK(expr) \
+    do { if (!(expr)) Test::fail(__FILE__, __LINE__, #expr); } while(false)
+
+#define CHECK_THROWS(expr, Exception) \
+    do { \
+        bool testThrown = false; \
+        try { (void)(expr); } catch(const Exception &) { testThrown = true; } \
+        if (!testThrown) Test::fail(__FILE__, __LINE__, #expr " does not throw " #Exception); \
+    } while(false)
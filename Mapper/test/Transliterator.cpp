@@ -0,0 +1,53 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+
+#include <Mapper/InlineTransliterator.hpp>
+
+namespace {
+
+    /** Output of Transliterator for keys typed one character at a time */
+    template<class Transliterator>
+    auto type(std::u16string_view keys) -> std::u16string {
+        Transliterator transliterator;
+        std::u16string ret;
+        for(auto c: keys) {
+            transliterator.append(std::u16string_view(&c, 1));
+            ret += transliterator.result().substr(0, transliterator.completedSize());
+            transliterator.clearCompleted();
+        }
+        transliterator.finish();
+        return ret += transliterator.result();
+    }
+
+    template<class Mapper>
+    void checkResumingSameAsRescanning(std::u16string_view keys) {
+        using Resuming = BasicTransliterator<Mapper, PrefixMatching::resume>;
+        using InlineResuming = InlineTransliterator<Mapper, 64, PrefixMatching::resume>;
+
+        auto expected = type<BasicTransliterator<Mapper>>(keys);
+        CHECK(type<Resuming>(keys) == expected);
+        CHECK(type<InlineTransliterator<Mapper>>(keys) == expected);
+        CHECK(type<InlineResuming>(keys) == expected);
+    }
+
+    /** A key that stays pending and ambiguous for 31 characters */
+    constexpr auto g_longKeyMapper = makePrefixMapper<TableRange,
+        Mapping{u'1', u"a"},
+        Mapping{u'2', u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"}
+    >();
+}
+
+TEST_CASE(resumingTransliteratorSameAsRescanning) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        std::mt19937 rng(1);
+        checkResumingSameAsRescanning<decltype(mapper)>(randomWords(rng, alphabetOf(mapper.matcher), 20'000));
+    });
+    Test::Context context("long key");
+    std::mt19937 rng(1);
+    checkResumingSameAsRescanning<decltype(g_longKeyMapper)>(randomWords(rng, u"ab", 20'000));
+    checkResumingSameAsRescanning<decltype(g_longKeyMapper)>(u"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+}
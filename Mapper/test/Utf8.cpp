@@ -0,0 +1,103 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+#include "Tables.h"
+#include "Utf8.h"
+
+#include <Mapper/Utf8Mapper.hpp>
+
+namespace {
+
+    /** Keys of two, three and four bytes so that malformed input can stop in the middle of one */
+    constexpr auto g_wideKeyMapper = makePrefixMapper<TableRange,
+        Mapping{u'a', u"щ"},
+        Mapping{u"bb", u"щя"},
+        Mapping{u'c', u"\U0001F600"},
+        Mapping{u'd', u"€"},
+        Mapping{u"\U0001F601", u"€x"},
+        Mapping{u'e', u"x"}
+    >();
+
+    /** Malformed UTF-8: stray continuations, truncated sequences, overlong forms, surrogates, values past U+10FFFF */
+    constexpr std::string_view g_malformed[] = {
+        "\x80", "\xBF", "\xD0", "\xD1", "\xE2\x82", "\xF0\x9F\x98", "\xC0\xAF", "\xE0\x80\x80",
+        "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8\x88\x80\x80\x80", "\xFE", "\xFF"
+    };
+
+    /** UTF-8 of random text drawn from alphabet with a malformed sequence after about every 8th character */
+    auto randomUtf8(std::mt19937 & rng, std::u16string_view alphabet, size_t length) -> std::string {
+        std::uniform_int_distribution<size_t> malformed(0, std::size(g_malformed) * 8 - 1);
+        std::string ret;
+        for(auto c: randomText(rng, alphabet, length)) {
+            ret += utf16ToUtf8(std::u16string_view(&c, 1));
+            if (auto idx = malformed(rng); idx < std::size(g_malformed))
+                ret += g_malformed[idx];
+        }
+        return ret;
+    }
+
+    template<class Mapper>
+    auto transliterateUtf16(const Mapper & mapper, std::u16string_view in) -> std::u16string {
+        std::u16string ret;
+        transliterate(mapper, in, ret);
+        return ret;
+    }
+
+    /** transliterateUtf8() gives the same bytes as going through UTF-16, malformed bytes passed through as is */
+    template<class Mapper>
+    void checkSameAsUtf16(const Mapper & mapper, std::string_view in) {
+        std::string actual;
+        transliterateUtf8(mapper, in, actual);
+        CHECK(actual == utf16ToUtf8(transliterateUtf16(mapper, utf8ToUtf16(in))));
+    }
+
+    /** transliterateDefinite() over chunks of chunkSize bytes followed by transliterate() of the rest is the same as the whole */
+    template<class Mapper>
+    void checkChunked(const Mapper & mapper, std::string_view in, size_t chunkSize) {
+        auto utf8 = makeUtf8Mapper(mapper);
+        std::string whole;
+        transliterate(utf8, in, whole);
+
+        std::string chunked;
+        std::string pending;
+        for(size_t start = 0; start < in.size(); start += chunkSize) {
+            pending += in.substr(start, chunkSize);
+            pending.erase(0, transliterateDefinite(utf8, pending, chunked));
+        }
+        transliterate(utf8, pending, chunked);
+        CHECK(chunked == whole);
+    }
+
+    template<class Mapper>
+    void checkUtf8(const Mapper & mapper) {
+        //every character of every key, Latin, Cyrillic, Hebrew and outside the BMP
+        auto alphabet = alphabetOf(mapper.matcher, u" .,1zжא\U0001F600");
+
+        std::mt19937 rng(1);
+        for(int i = 0; i < 1'000; ++i) {
+            auto in = randomUtf8(rng, alphabet, rng() % 16);
+            checkSameAsUtf16(mapper, in);
+            //cut short at every byte
+            for(size_t length = 0; length < in.size(); ++length)
+                checkSameAsUtf16(mapper, std::string_view(in).substr(0, length));
+        }
+        auto in = randomUtf8(rng, alphabet, 20'000);
+        checkSameAsUtf16(mapper, in);
+        for(size_t chunkSize: {1, 2, 3, 5, 64, 4096})
+            checkChunked(mapper, in, chunkSize);
+    }
+}
+
+TEST_CASE(utf8SameAsUtf16) {
+    forEachShippedTable([](const char * name, auto mapper) {
+        Test::Context context(name);
+        checkUtf8(mapper);
+    });
+    Test::Context context("wide keys");
+    checkUtf8(g_wideKeyMapper);
+
+    std::string out;
+    transliterateUtf8(g_wideKeyMapper, "\xD1\x89\xD1\x8F\xD1\x89\xD1\xF0\x9F\x98\x80\xF0\x9F\x98\xE2\x82\xAC", out);
+    CHECK(out == "bba\xD1" "c\xF0\x9F\x98" "d");
+}
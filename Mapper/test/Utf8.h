@@ -0,0 +1,76 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ UTF-16 of a UTF-8 string, keeping every byte that is not part of a valid sequence
+
+ Such a byte b becomes the unpaired low surrogate 0xDC00 + b, as in Python's surrogateescape.
+ Nothing maps unpaired surrogates so transliteration passes them through, the same way a
+ UTF-8 mapper passes through bytes it doesn't recognize.
+ */
+inline auto utf8ToUtf16(std::string_view str) -> std::u16string {
+    std::u16string ret;
+    ret.reserve(str.size());
+    for(size_t i = 0; i < str.size(); ) {
+        auto byte = (unsigned char)str[i];
+        size_t length = (byte < 0x80 ? 1 : (byte & 0xE0) == 0xC0 ? 2 : (byte & 0xF0) == 0xE0 ? 3 : (byte & 0xF8) == 0xF0 ? 4 : 0);
+        char32_t c = (length == 1 ? byte : length == 2 ? byte & 0x1F : length == 3 ? byte & 0x0F : byte & 0x07);
+        bool valid = (length != 0 && i + length <= str.size());
+        for(size_t j = 1; valid && j < length; ++j) {
+            auto next = (unsigned char)str[i + j];
+            valid = ((next & 0xC0) == 0x80);
+            c = (c << 6) | (next & 0x3F);
+        }
+        constexpr char32_t minValues[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (!valid || c < minValues[length] || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000)) {
+            ret += char16_t(0xDC00 + byte);
+            ++i;
+            continue;
+        }
+        if (c < 0x10000) {
+            ret += char16_t(c);
+        } else {
+            ret += char16_t(0xD800 + ((c - 0x10000) >> 10));
+            ret += char16_t(0xDC00 + ((c - 0x10000) & 0x3FF));
+        }
+        i += length;
+    }
+    return ret;
+}
+
+/** UTF-8 of a UTF-16 string. An unpaired low surrogate 0xDC00 + b below 0xDD00 turns back into the byte b */
+inline auto utf16ToUtf8(std::u16string_view str) -> std::string {
+    std::string ret;
+    ret.reserve(str.size() * 3);
+    for(size_t i = 0; i < str.size(); ++i) {
+        char32_t c = str[i];
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < str.size() && str[i + 1] >= 0xDC00 && str[i + 1] < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (str[i + 1] - 0xDC00);
+            ++i;
+        } else if (c >= 0xDC00 && c < 0xDD00) {
+            ret += char(c - 0xDC00);
+            continue;
+        }
+        if (c < 0x80) {
+            ret += char(c);
+        } else if (c < 0x800) {
+            ret += char(0xC0 | (c >> 6));
+            ret += char(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            ret += char(0xE0 | (c >> 12));
+            ret += char(0x80 | ((c >> 6) & 0x3F));
+            ret += char(0x80 | (c & 0x3F));
+        } else {
+            ret += char(0xF0 | (c >> 18));
+            ret += char(0x80 | ((c >> 12) & 0x3F));
+            ret += char(0x80 | ((c >> 6) & 0x3F));
+            ret += char(0x80 | (c & 0x3F));
+        }
+    }
+    return ret;
+}
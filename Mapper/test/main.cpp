@@ -0,0 +1,76 @@
+// Copyright (c) 2023, Eugene Gershnik
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "Test.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    Test::Case * g_first = nullptr;
+    Test::Case ** g_last = &g_first;
+    Test::Context * g_context = nullptr;
+    size_t g_failures = 0;
+    //failures beyond this per case only count
+    constexpr size_t g_maxReported = 20;
+}
+
+bool Test::add(Case & testCase) noexcept {
+    *g_last = &testCase;
+    g_last = &testCase.next;
+    return true;
+}
+
+void Test::fail(const char * file, int line, const char * what) noexcept {
+    if (g_failures++ < g_maxReported) {
+        std::fprintf(stderr, "%s(%d): check failed: %s", file, line, what);
+        Context::print(stderr);
+        std::fputc('\n', stderr);
+    }
+}
+
+Test::Context::Context(const char * label) noexcept:
+    m_label(label),
+    m_outer(g_context) {
+    g_context = this;
+}
+
+Test::Context::~Context() noexcept {
+    g_context = m_outer;
+}
+
+void Test::Context::print(std::FILE * fp) noexcept {
+    for(auto context = g_context; context; context = context->m_outer)
+        std::fprintf(fp, " [%s]", context->m_label);
+}
+
+/**
+ Usage: mapper-test [filter]
+
+ Runs the cases whose names contain filter or all of them
+ */
+int main(int argc, char * argv[]) {
+    const char * filter = (argc > 1 ? argv[1] : "");
+
+    size_t run = 0;
+    size_t failed = 0;
+    for(auto testCase = g_first; testCase; testCase = testCase->next) {
+        if (!std::strstr(testCase->name, filter))
+            continue;
+        std::printf("%s\n", testCase->name);
+        std::fflush(stdout);
+        g_failures = 0;
+        try {
+            testCase->func();
+        } catch(std::exception & ex) {
+            Test::fail(__FILE__, __LINE__, ex.what());
+        }
+        ++run;
+        if (g_failures) {
+            std::fprintf(stderr, "%s: %zu check(s) failed\n", testCase->name, g_failures);
+            ++failed;
+        }
+    }
+    std::printf("%zu case(s) run, %zu failed\n", run, failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -195,7 +195,11 @@ def generate_mapping_header(config: dict[str, Any]):
             for dst, src in get_execution_mappings(varname, section):
                 if line_count > 0:
                     content += ',\n'
-                content += f"    Mapping{{u'{dst}', u\"{quote_cpp_string(src)}\"}}"
+                #multi-character outputs, including a single non-BMP character, need a string
+                if len(dst.encode('utf-16-le')) > 2:
+                    content += f"    Mapping{{u\"{quote_cpp_string(dst)}\", u\"{quote_cpp_string(src)}\"}}"
+                else:
+                    content += f"    Mapping{{u'{dst}', u\"{quote_cpp_string(src)}\"}}"
                 line_count += 1
         content += '\n>();\n'
 
@@ -431,6 +435,66 @@ def generate_implementation(impl: Impl):
         ''')
     write_file_if_different(ROOTDIR / 'Translit/src/Languages.cpp', content)
 
+def generate_cli_implementation(impl: Impl):
+    content = dedent('''\
+        // Copyright (c) 2023, Eugene Gershnik
+        // SPDX-License-Identifier: GPL-3.0-or-later
+                     
+        // THIS FILE IS AUTO-GENERATED. DO NOT EDIT.
+
+        #include "Languages.h"
+
+        #include <Mapper/Utf8Mapper.hpp>
+
+        ''')
+    content += '\n'.join([f'#include "../../Translit/{header.removeprefix("../")}"' for header in impl.headers])
+    content += dedent('''
+
+        using Range = Transliterator::Range;
+
+        template<class Mapper>
+        auto serialize() -> std::vector<std::byte> {
+            return serializeTable(Mapper{});
+        }
+
+        template<class Mapper>
+        auto transliterateUtf8Chunk(std::string_view in, std::string & out, bool final) -> size_t {
+            constexpr auto mapper = makeUtf8Mapper(Mapper{});
+            if (!final)
+                return transliterateDefinite(mapper, in, out);
+            transliterate(mapper, in, out);
+            return in.size();
+        }
+        ''')
+
+    for lang, lang_info in impl.languages.items():
+        content += f'\nconstexpr MappingInfo g_{lang}Mappings[] = {{\n'
+        for variant in lang_info.variants:
+            varname = variant.name
+            variable = make_mapper_name(lang, varname)
+            display = variant.display_name
+            var_id = varname if varname != 'default' else ''
+            content += f'    {{ "{var_id}", "{display}", {variable}<Range>, serialize<decltype({variable}<Range>)>, transliterateUtf8Chunk<decltype({variable}<Range>)> }},\n'
+        content += '};\n'
+
+    content += dedent('''
+        constexpr LanguageInfo g_languages[] = {
+        ''')
+    for idx, (lang, lang_info) in enumerate(impl.languages.items()):
+        if idx > 0:
+            content += ',\n'
+        content += f'    {{ "{lang}", "{lang_info.name}", g_{lang}Mappings }}'
+
+    content += dedent('''
+        };
+
+        auto getLanguages() -> std::span<const LanguageInfo> {
+            return g_languages;
+        }
+
+        ''')
+    write_file_if_different(ROOTDIR / 'Cli/src/Languages.cpp', content)
+
 def main():
     languages = ['be', 'he', 'ru', 'uk']
     for lang in languages:
@@ -461,6 +525,7 @@ def main():
 
     generate_html(html)
     generate_implementation(impl)
+    generate_cli_implementation(impl)
     return 0
     
 